@@ -0,0 +1,335 @@
+#ifndef __NN_NNBATCHING__
+#define __NN_NNBATCHING__
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <ostream>
+#include <functional>
+#include "NNModel.hpp"
+
+/*
+    Agrupación dinámica de peticiones de una muestra en lotes.
+
+        NN::BatchingExecutor<float> exec(NN::loadModel<float>("./data/nn1.toml"), 32, 200);
+        auto result = exec.submit(input);   // std::future<std::vector<float>>
+        exec.submit(input, [](const float* out, size_t len){...});
+
+    Cualquier hilo puede llamar a submit(): la petición se encola en una cola
+    MPSC sin locks. Un hilo despachador junta hasta max_batch peticiones, o las
+    que haya cuando la más antigua lleva max_wait_us esperando, hace una sola
+    pasada computeBatch y reparte las salidas. Sin peticiones durante
+    NN_BATCH_PARK_US el despachador se duerme en una variable de condición;
+    submit() solo toma el mutex para despertarlo cuando está dormido.
+    Una excepción en un callback se cuenta (callbackErrors()) y no corta el lote.
+*/
+
+// Espera máxima del despachador sin peticiones pendientes
+#ifndef NN_BATCH_IDLE_US
+#define NN_BATCH_IDLE_US 50
+#endif
+
+// Tiempo sin peticiones tras el que el despachador deja de sondear la cola y se duerme
+#ifndef NN_BATCH_PARK_US
+#define NN_BATCH_PARK_US 2000
+#endif
+
+namespace NN{
+
+/* Histograma de potencias de dos: el cubo k cuenta valores en [2^k, 2^(k+1)),
+   el cubo 0 también cuenta el 0. Lo escribe un hilo y se puede leer desde otros. */
+class Histogram
+{
+    private:
+        static constexpr size_t _buckets = 32;
+        std::atomic<uint64_t> _count[_buckets] = {};
+        std::atomic<uint64_t> _total{0}, _sum{0}, _max{0};
+
+        static size_t bucket(uint64_t v)
+        {
+            size_t k = 0;
+            while (v > 1 && k+1 < _buckets)
+            {
+                v >>= 1;
+                ++k;
+            }
+            return k;
+        }
+    public:
+        void record(uint64_t v)
+        {
+            _count[bucket(v)].fetch_add(1, std::memory_order_relaxed);
+            _total.fetch_add(1, std::memory_order_relaxed);
+            _sum.fetch_add(v, std::memory_order_relaxed);
+            if (v > _max.load(std::memory_order_relaxed))
+                _max.store(v, std::memory_order_relaxed);
+        }
+        uint64_t count() const {return _total.load(std::memory_order_relaxed);}
+        uint64_t max() const {return _max.load(std::memory_order_relaxed);}
+        double mean() const {return count() ? double(_sum.load(std::memory_order_relaxed))/count() : 0.0;}
+        uint64_t count(size_t k) const {return k < _buckets ? _count[k].load(std::memory_order_relaxed) : 0;}
+        // Cota superior del percentil p (0-100) según el cubo donde cae
+        uint64_t percentile(double p) const
+        {
+            const uint64_t total = count();
+            uint64_t acc = 0;
+            for (size_t k = 0; k < _buckets; k++)
+            {
+                acc += count(k);
+                if (total && acc*100.0 >= p*total)
+                    return std::min<uint64_t>((uint64_t(2) << k) - 1, max());
+            }
+            return max();
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const Histogram &h)
+        {
+            os << "n=" << h.count() << " mean=" << h.mean() << " p50<=" << h.percentile(50)
+               << " p99<=" << h.percentile(99) << " max=" << h.max() << std::endl;
+            for (size_t k = 0; k < _buckets; k++)
+            {
+                if (h.count(k))
+                    os << "  [" << (k ? uint64_t(1) << k : 0) << ", " << (uint64_t(2) << k) << "): " << h.count(k) << std::endl;
+            }
+            return os;
+        }
+};
+
+template<typename T = float>
+class BatchingExecutor
+{
+    public:
+        // Recibe la salida de la muestra, o nullptr si la pasada falló
+        using Callback = std::function<void(const T* out, size_t len)>;
+    private:
+        using clock = std::chrono::steady_clock;
+        struct Request
+        {
+            std::vector<T> in;
+            std::promise<std::vector<T>> promise;
+            Callback callback;
+            clock::time_point t;
+            std::atomic<Request*> next{nullptr};
+        };
+
+        /* Cola MPSC intrusiva (Vyukov): push es un exchange atómico, pop solo
+           lo llama el despachador. */
+        std::atomic<Request*> _head;
+        Request* _tail;
+        Request _stub;
+
+        std::shared_ptr<const Model<T>> _model;
+        size_t _max_batch;
+        std::chrono::microseconds _max_wait;
+        Histogram _batch_sizes, _queue_delay;
+        std::atomic<uint64_t> _callback_errors{0};
+        std::atomic<bool> _stop{false};
+        std::atomic<bool> _parked{false}; // El despachador duerme en _park_cv
+        std::mutex _park_m;
+        std::condition_variable _park_cv;
+        std::thread _dispatcher;
+
+        // seq_cst: o el despachador ve la petición antes de dormirse o submit() ve _parked
+        void push(Request* r)
+        {
+            r->next.store(nullptr, std::memory_order_relaxed);
+            Request* prev = _head.exchange(r);
+            prev->next.store(r, std::memory_order_release);
+        }
+        Request* pop()
+        {
+            Request* tail = _tail;
+            Request* next = tail->next.load(std::memory_order_acquire);
+            if (tail == &_stub)
+            {
+                if (!next)
+                    return nullptr;
+                _tail = next;
+                tail = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next)
+            {
+                _tail = next;
+                return tail;
+            }
+            if (tail != _head.load(std::memory_order_acquire))
+                return nullptr; // Un push a medias, se verá en la siguiente vuelta
+            push(&_stub);
+            next = tail->next.load(std::memory_order_acquire);
+            if (next)
+            {
+                _tail = next;
+                return tail;
+            }
+            return nullptr;
+        }
+
+        void enqueue(const T* in, Request* r)
+        {
+            r->in.assign(in, in+_model->getInputSize());
+            r->t = clock::now();
+            push(r);
+            if (_parked.load())
+            {
+                {
+                    std::lock_guard<std::mutex> lk(_park_m);
+                    _parked.store(false);
+                }
+                _park_cv.notify_one();
+            }
+        }
+        // Duerme hasta el siguiente submit() o el destructor, salvo que ya haya algo en la cola
+        void park()
+        {
+            std::unique_lock<std::mutex> lk(_park_m);
+            _parked.store(true);
+            if (_head.load() == _tail && !_stop.load())
+                _park_cv.wait(lk, [&]{return !_parked.load() || _stop.load();});
+            _parked.store(false);
+        }
+
+        void run(std::vector<Request*> &batch, ExecutionContext<T> &ctx, std::vector<T> &in, std::vector<T> &out)
+        {
+            const size_t si = _model->getInputSize(), so = _model->getOutputSize();
+            const size_t n = batch.size();
+            const auto start = clock::now();
+            in.resize(n*si);
+            out.resize(n*so);
+            for (size_t k = 0; k < n; k++)
+            {
+                std::copy(batch[k]->in.begin(), batch[k]->in.end(), in.begin()+k*si);
+                _queue_delay.record(std::chrono::duration_cast<std::chrono::microseconds>(start - batch[k]->t).count());
+            }
+            _batch_sizes.record(n);
+
+            std::exception_ptr error;
+            try
+            {
+                ctx.computeBatch(in.data(), out.data(), n);
+            }
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+            for (size_t k = 0; k < n; k++)
+            {
+                Request* r = batch[k];
+                const T* y = out.data()+k*so;
+                if (r->callback)
+                {
+                    try
+                    {
+                        r->callback(error ? nullptr : y, so);
+                    }
+                    catch(...)
+                    {
+                        _callback_errors.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                else if (error)
+                    r->promise.set_exception(error);
+                else
+                    r->promise.set_value(std::vector<T>(y, y+so));
+                delete r;
+            }
+            batch.clear();
+        }
+
+        void dispatch()
+        {
+            ExecutionContext<T> ctx(_model);
+            std::vector<T> in, out;
+            std::vector<Request*> batch;
+            batch.reserve(_max_batch);
+            unsigned idle_us = 1;
+            clock::time_point idle_since;
+            for (;;)
+            {
+                Request* r = pop();
+                if (!r)
+                {
+                    if (_stop.load(std::memory_order_acquire) && _head.load() == &_stub)
+                        return;
+                    const auto now = clock::now();
+                    if (idle_us == 1)
+                        idle_since = now;
+                    else if (now - idle_since >= std::chrono::microseconds(NN_BATCH_PARK_US))
+                    {
+                        park();
+                        idle_us = 1;
+                        continue;
+                    }
+                    std::this_thread::sleep_for(std::chrono::microseconds(idle_us));
+                    idle_us = std::min<unsigned>(2*idle_us, NN_BATCH_IDLE_US);
+                    continue;
+                }
+                idle_us = 1;
+                batch.push_back(r);
+                const auto deadline = r->t + _max_wait;
+                while (batch.size() < _max_batch)
+                {
+                    if ((r = pop()))
+                    {
+                        batch.push_back(r);
+                        continue;
+                    }
+                    if (clock::now() >= deadline || _stop.load(std::memory_order_relaxed))
+                        break;
+                    std::this_thread::yield();
+                }
+                run(batch, ctx, in, out);
+            }
+        }
+    public:
+        BatchingExecutor() = delete;
+        BatchingExecutor(std::shared_ptr<const Model<T>> model, size_t max_batch = 32, unsigned max_wait_us = 200)
+            : _head(&_stub), _tail(&_stub), _model(std::move(model)), _max_batch(std::max<size_t>(max_batch, 1)), _max_wait(max_wait_us)
+        {
+            _dispatcher = std::thread([this]{dispatch();});
+        }
+        BatchingExecutor(const Net<T> &net, size_t max_batch = 32, unsigned max_wait_us = 200)
+            : BatchingExecutor(Model<T>::create(net), max_batch, max_wait_us) {}
+        BatchingExecutor(const BatchingExecutor&) = delete;
+        BatchingExecutor& operator=(const BatchingExecutor&) = delete;
+        // Atiende las peticiones pendientes antes de terminar
+        ~BatchingExecutor()
+        {
+            {
+                std::lock_guard<std::mutex> lk(_park_m);
+                _stop.store(true);
+            }
+            _park_cv.notify_one();
+            _dispatcher.join();
+        }
+
+        // in debe tener getInputSize() elementos; se copia antes de volver.
+        std::future<std::vector<T>> submit(const T* in)
+        {
+            Request* r = new Request;
+            auto result = r->promise.get_future();
+            enqueue(in, r);
+            return result;
+        }
+        void submit(const T* in, Callback callback)
+        {
+            Request* r = new Request;
+            r->callback = std::move(callback);
+            enqueue(in, r);
+        }
+
+        const Histogram& batchSizes() const {return _batch_sizes;}
+        const Histogram& queueDelayUs() const {return _queue_delay;}
+        // Callbacks que han lanzado una excepción
+        uint64_t callbackErrors() const {return _callback_errors.load(std::memory_order_relaxed);}
+        uint16_t getInputSize() const {return _model->getInputSize();}
+        uint16_t getOutputSize() const {return _model->getOutputSize();}
+};
+
+}
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef __NN_NNBENCH__
+#define __NN_NNBENCH__
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+
+/*
+    Arnés de micro-benchmarks (lo usa bench.cpp).
+
+        NN::bench::Runner runner;
+        runner.run("ReLu/1024", flops, bytes, [&]{relu.compute();});
+        runner.print(std::cout);
+        runner.writeJSON(file);
+
+    Cada caso se calibra para que una medición dure al menos min_ms/NN_BENCH_RUNS
+    y se mide NN_BENCH_RUNS veces. Se guarda la mediana (la que se compara) y
+    la mínima en ns por operación. Las flops y los bytes por operación los
+    declara el caso; con ellos se dan GFLOP/s y GB/s. El JSON lleva un objeto
+    por línea para poder leerlo sin un parser completo (readJSON) y usarlo
+    como línea base en compare().
+*/
+
+// Mediciones por caso
+#ifndef NN_BENCH_RUNS
+#define NN_BENCH_RUNS 7
+#endif
+
+namespace NN{
+namespace bench{
+
+struct Result
+{
+    std::string name;
+    double ns = 0;      // Mediana, ns por operación
+    double ns_min = 0;
+    double flops = 0;   // Por operación
+    double bytes = 0;   // Por operación
+    size_t iters = 0;   // Operaciones por medición
+
+    double gflops() const {return ns > 0 ? flops/ns : 0;}
+    double gbytes() const {return ns > 0 ? bytes/ns : 0;}
+};
+
+// Evita que el compilador descarte un resultado que no se usa: el asm vacío "lee" p y la memoria
+inline void keep(const void* p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(p) : "memory");
+#else
+    static const void* volatile sink;
+    sink = p;
+    (void)sink;
+#endif
+}
+
+class Runner
+{
+    private:
+        double _min_ms;
+        std::string _filter;
+        std::vector<Result> _results;
+    public:
+        // Solo se ejecutan los casos cuyo nombre contiene filter
+        explicit Runner(double min_ms = 100, std::string filter = "") : _min_ms(min_ms), _filter(std::move(filter)) {}
+
+        template<typename F>
+        void run(const std::string &name, double flops, double bytes, F &&op)
+        {
+            if (!_filter.empty() && name.find(_filter) == std::string::npos)
+                return;
+            using clock = std::chrono::steady_clock;
+            auto measure = [&](size_t n){
+                auto t0 = clock::now();
+                for (size_t k = 0; k < n; k++)
+                    op();
+                return std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+            };
+            const double target = _min_ms*1e6/NN_BENCH_RUNS;
+            size_t n = 1;
+            double t = measure(n);
+            while (t < target && n < (size_t(1) << 40))
+            {
+                n = t > 0 ? std::max<size_t>(2*n, size_t(n*1.2*target/t)) : 2*n;
+                t = measure(n);
+            }
+            std::vector<double> runs(NN_BENCH_RUNS);
+            for (auto &r : runs)
+                r = measure(n)/n;
+            std::sort(runs.begin(), runs.end());
+            _results.push_back({name, runs[runs.size()/2], runs.front(), flops, bytes, n});
+        }
+        const std::vector<Result>& results() const {return _results;}
+
+        void print(std::ostream &os) const
+        {
+            os << std::left << std::setw(32) << "caso" << std::right << std::setw(14) << "ns/op" << std::setw(14) << "min ns/op"
+               << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s" << std::setw(14) << "bytes/op" << std::endl;
+            for (auto &r : _results)
+            {
+                os << std::left << std::setw(32) << r.name << std::right << std::fixed << std::setprecision(1)
+                   << std::setw(14) << r.ns << std::setw(14) << r.ns_min << std::setprecision(2)
+                   << std::setw(10) << r.gflops() << std::setw(10) << r.gbytes() << std::setprecision(0)
+                   << std::setw(14) << r.bytes << std::endl;
+            }
+            os.unsetf(std::ios::fixed);
+        }
+        void writeJSON(std::ostream &os, const std::string &isa = "") const
+        {
+            os << "{\n  \"isa\": \"" << isa << "\",\n  \"results\": [\n";
+            for (size_t k = 0; k < _results.size(); k++)
+            {
+                auto &r = _results[k];
+                os << std::setprecision(9)
+                   << "    {\"name\": \"" << r.name << "\", \"ns_per_op\": " << r.ns << ", \"ns_min\": " << r.ns_min
+                   << ", \"gflops\": " << r.gflops() << ", \"bytes_per_op\": " << r.bytes << ", \"gbytes_per_s\": " << r.gbytes()
+                   << ", \"iters\": " << r.iters << "}" << (k+1 < _results.size() ? "," : "") << "\n";
+            }
+            os << "  ]\n}\n";
+        }
+};
+
+// Lee los nombres y tiempos de un JSON escrito por Runner::writeJSON
+inline std::vector<Result> readJSON(std::istream &is)
+{
+    std::vector<Result> out;
+    std::string line;
+    auto field = [](const std::string &l, const char* key, size_t &pos){
+        pos = l.find(std::string("\"") + key + "\": ");
+        if (pos != std::string::npos)
+            pos += std::string(key).size() + 4;
+        return pos != std::string::npos;
+    };
+    while (std::getline(is, line))
+    {
+        size_t p;
+        if (!field(line, "name", p) || line[p] != '"')
+            continue;
+        Result r;
+        r.name = line.substr(p+1, line.find('"', p+1) - p - 1);
+        if (field(line, "ns_per_op", p))
+            r.ns = std::strtod(line.c_str()+p, nullptr);
+        if (field(line, "ns_min", p))
+            r.ns_min = std::strtod(line.c_str()+p, nullptr);
+        if (field(line, "bytes_per_op", p))
+            r.bytes = std::strtod(line.c_str()+p, nullptr);
+        out.push_back(r);
+    }
+    return out;
+}
+
+/* Compara con una línea base por nombre. Un caso es regresión si su mediana
+   supera a la de la base en más de threshold (0.1 = 10 %). Devuelve cuántas hay. */
+inline size_t compare(const std::vector<Result> &current, const std::vector<Result> &baseline, double threshold, std::ostream &os)
+{
+    size_t regressions = 0;
+    os << std::left << std::setw(32) << "caso" << std::right << std::setw(14) << "base ns/op" << std::setw(14) << "ns/op" << std::setw(10) << "cambio" << std::endl;
+    for (auto &r : current)
+    {
+        auto it = std::find_if(baseline.begin(), baseline.end(), [&](const Result &b){return b.name == r.name;});
+        if (it == baseline.end() || it->ns <= 0)
+            continue;
+        const double change = r.ns/it->ns - 1;
+        const bool bad = change > threshold;
+        regressions += bad;
+        os << std::left << std::setw(32) << r.name << std::right << std::fixed << std::setprecision(1)
+           << std::setw(14) << it->ns << std::setw(14) << r.ns << std::setw(9) << std::showpos << 100*change << "%" << std::noshowpos
+           << (bad ? "  REGRESIÓN" : "") << std::endl;
+    }
+    os.unsetf(std::ios::fixed);
+    return regressions;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef __NN_NNCONV__
+#define __NN_NNCONV__
+
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "NNUtils.hpp"
+#include "NNKernels.hpp"
+
+/*
+    Núcleos de convolución.
+
+    Conv2DLayer baja la convolución a una GEMM (im2col): cada salida es el
+    producto escalar de su ventana de entrada, de K = C*kh*kw valores, por cada
+    filtro. im2col copia esas ventanas como filas de una matriz col[P][K] y
+        out[P][F] = col[P][K] * W[F][K]^T + B
+    es exactamente la GEMM de WGLayer con los filtros empaquetados una vez.
+    Las salidas se procesan en bloques de filas de col que caben en caché.
+
+    ConvLayer puede usar Winograd F(MxM, 3x3) con kernels 3x3 (Lavin y Gray, 2015):
+    una tesela de MxM salidas sale de una de (M+2)x(M+2) entradas como
+        Y = At [(G g Gt) .* (Bt d B)] A
+    con (M+2)^2 productos en vez de 9*M^2: 16 frente a 36 con M = 2 y 36
+    frente a 144 con M = 4. G g Gt se calcula una vez en setKernel. Las
+    transformadas son sumas con coeficientes fijos y se aplican a una franja
+    de teselas a la vez para que el compilador las vectorice. El error crece
+    con M: del orden de 1e-7 (M = 2) y 1e-6 (M = 4) relativo en float.
+
+    Si el kernel es de rango 1 (gaussiano, Sobel, caja...) k[i][j] = u[i]*v[j]
+    y la convolución se separa en una pasada por filas con v y otra por
+    columnas con u: kh + kw productos por salida en vez de kh*kw.
+
+    Un pooling justo detrás de ConvLayer se fusiona en Net::init(): la
+    convolución se calcula por bandas de las filas de una ventana, que quedan
+    en caché, y solo se escribe la salida reducida (poolRow).
+
+    En modo flujo (ConvLayer::push) las muestras se añaden a un búfer lineal
+    tras las kw-1 anteriores y cada salida nueva se calcula una sola vez.
+    Cuando el búfer se llena las kw-1 últimas vuelven al principio (solape y
+    descarte): una copia de kw-1 valores cada NN_STREAM_BLOCK muestras.
+*/
+
+// Bytes de la matriz col de un bloque de salidas de Conv2DLayer
+#ifndef NN_CONV_TILE_BYTES
+#define NN_CONV_TILE_BYTES (1 << 16)
+#endif
+
+// Muestras nuevas que caben en el búfer de ConvLayer::push antes de rotarlo
+#ifndef NN_STREAM_BLOCK
+#define NN_STREAM_BLOCK 1024
+#endif
+
+// Teselas de Winograd que ConvLayer transforma a la vez en una franja
+#ifndef NN_WINOGRAD_STRIP
+#define NN_WINOGRAD_STRIP 32
+#endif
+
+namespace NN{
+namespace kernels{
+
+/* Filas [q0, q1) de col (salida q = oy*Wo + ox) en col[q-q0][K], con las
+   columnas en el orden de los pesos: canal, fila y columna del kernel. */
+template<typename T>
+void im2col(const T* in, const Conv2DParams &p, size_t q0, size_t q1, T* col)
+{
+    const long H = p.input.rows, W = p.input.cols;
+    const long kh = p.kernel.rows, kw = p.kernel.cols;
+    const long sh = p.stride.rows, sw = p.stride.cols;
+    const long dh = p.dilation.rows, dw = p.dilation.cols;
+    const size_t C = p.channels, K = p.kernelLen(), Wo = p.output().cols;
+    const bool zero = p.pad_mode == PadMode::ZERO;
+    // Saltos entre canales, filas y columnas de la entrada
+    const size_t cs = p.layout == Layout::NCHW ? H*W : 1;
+    const size_t ys = p.layout == Layout::NCHW ? W : W*C;
+    const size_t xs = p.layout == Layout::NCHW ? 1 : C;
+
+    for (size_t q = q0; q < q1; q++)
+    {
+        const long y0 = long(q/Wo)*sh - p.pad.rows;
+        const long x0 = long(q%Wo)*sw - p.pad.cols;
+        T* dst = col + (q-q0)*K;
+        const bool inside = y0 >= 0 && x0 >= 0 && y0+(kh-1)*dh < H && x0+(kw-1)*dw < W;
+        for (size_t c = 0; c < C; c++)
+        {
+            const T* src = in + c*cs;
+            for (long ki = 0; ki < kh; ki++)
+            {
+                long iy = y0 + ki*dh;
+                if (inside)
+                {
+                    const T* row = src + iy*ys + x0*xs;
+                    for (long kj = 0; kj < kw; kj++)
+                        *dst++ = row[kj*dw*xs];
+                    continue;
+                }
+                if (iy < 0 || iy >= H)
+                {
+                    if (zero)
+                    {
+                        std::fill(dst, dst+kw, T(0));
+                        dst += kw;
+                        continue;
+                    }
+                    iy = std::min(std::max(iy, 0L), H-1);
+                }
+                const T* row = src + iy*ys;
+                for (long kj = 0; kj < kw; kj++)
+                {
+                    long ix = x0 + kj*dw;
+                    if (ix >= 0 && ix < W)
+                        *dst++ = row[ix*xs];
+                    else
+                        *dst++ = zero ? T(0) : row[std::min(std::max(ix, 0L), W-1)*xs];
+                }
+            }
+        }
+    }
+}
+
+// Salidas de col por bloque: múltiplo del panel de muestras de la GEMM
+template<typename T>
+size_t convTile(size_t K)
+{
+    constexpr size_t MR = GemmBlock<T>::MR;
+    return std::max<size_t>(MR, NN_CONV_TILE_BYTES/(K*sizeof(T))/MR*MR);
+}
+
+/* Salidas [q0, q1) de una muestra. Wp son los filtros W[F][K] empaquetados
+   con packWeights. col y y son buffers del llamante de (q1-q0)*K y
+   (q1-q0)*F elementos (y solo se usa en NCHW). */
+template<typename T>
+void conv2dTile(const T* in, const T* Wp, const T* B, T* out, const Conv2DParams &p, size_t q0, size_t q1, T* col, T* y)
+{
+    const size_t F = p.filters, K = p.kernelLen();
+    const dim_t o = p.output();
+    const size_t P = size_t(o.rows)*o.cols;
+    im2col(in, p, q0, q1, col);
+    if (p.layout == Layout::NHWC)
+    {
+        gemm(Wp, B, col, out + q0*F, q1-q0, F, K);
+        return;
+    }
+    gemm(Wp, B, col, y, q1-q0, F, K);
+    for (size_t f = 0; f < F; f++)
+    {
+        T* dst = out + f*P + q0;
+        for (size_t q = 0; q < q1-q0; q++)
+            dst[q] = y[q*F+f];
+    }
+}
+
+/* Descompone k[rows][cols] como u[rows] x v[cols] si es de rango 1 con
+   error |k - u*v| <= 64*eps*max|k| en cada elemento. Toma como pivote el
+   elemento de mayor módulo: u es su columna y v su fila dividida por él. */
+template<typename T>
+bool separate(const T* k, size_t rows, size_t cols, T* u, T* v)
+{
+    const size_t n = rows*cols;
+    size_t p = 0;
+    for (size_t i = 1; i < n; i++)
+        if (std::abs(k[i]) > std::abs(k[p]))
+            p = i;
+    const T pivot = k[p];
+    if (pivot == T(0))
+        return false;
+    const size_t pi = p/cols, pj = p%cols;
+    for (size_t i = 0; i < rows; i++)
+        u[i] = k[i*cols+pj];
+    for (size_t j = 0; j < cols; j++)
+        v[j] = k[pi*cols+j]/pivot;
+    const T tol = 64*std::numeric_limits<T>::epsilon()*std::abs(pivot);
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = 0; j < cols; j++)
+            if (std::abs(k[i*cols+j] - u[i]*v[j]) > tol)
+                return false;
+    return true;
+}
+
+// out[j] = sum_kj in[j+kj]*k[kj], j < n. Recorre la salida por cada coeficiente para vectorizar
+template<typename T>
+void correlate1D(const T* in, const T* k, size_t kw, T* out, size_t n)
+{
+    std::fill(out, out+n, T(0));
+    for (size_t kj = 0; kj < kw; kj++)
+    {
+        const T c = k[kj];
+        const T* src = in + kj;
+        for (size_t j = 0; j < n; j++)
+            out[j] += src[j]*c;
+    }
+}
+
+/* Convolución separable de las salidas [i0, i1) x [j0, j1) de una imagen con
+   ld columnas, kernel u (kh filas) x v (kw columnas) centrado en (ci, cj).
+   Las ventanas deben estar dentro de la imagen. tmp: (i1-i0+kh-1)*ld elementos.
+   out empieza en la fila oy de la salida. */
+template<typename T>
+void separableRegion(const T* in, T* out, size_t ld, const T* u, size_t kh, const T* v, size_t kw,
+                     size_t ci, size_t cj, size_t i0, size_t i1, size_t j0, size_t j1, T* tmp, size_t oy = 0)
+{
+    const size_t w = j1 - j0;
+    // Filas: tmp[y][j] = sum_kj in[y][j-cj+kj]*v[kj]
+    for (size_t y = i0-ci; y < i1-ci+kh-1; y++)
+        correlate1D(in + y*ld + j0 - cj, v, kw, tmp + (y-(i0-ci))*ld, w);
+    // Columnas: out[i][j] = sum_ki tmp[i-ci+ki][j]*u[ki]
+    for (size_t i = i0; i < i1; i++)
+    {
+        T* dst = out + (i-oy)*ld + j0;
+        std::fill(dst, dst+w, T(0));
+        for (size_t ki = 0; ki < kh; ki++)
+        {
+            const T c = u[ki];
+            const T* src = tmp + (i-i0+ki)*ld;
+            for (size_t j = 0; j < w; j++)
+                dst[j] += src[j]*c;
+        }
+    }
+}
+
+/* Una fila de salida del pooling: out[j] = max o media de in[i*ld + j*sw + q]
+   con i < ph, q < pw. in apunta a la primera fila de la ventana. */
+template<typename T>
+void poolRow(const T* in, size_t ld, T* out, size_t ow, size_t ph, size_t pw, size_t sw, PoolMode mode)
+{
+    if (mode == PoolMode::MAX)
+    {
+        for (size_t j = 0; j < ow; j++)
+            out[j] = in[j*sw];
+        for (size_t i = 0; i < ph; i++)
+            for (size_t q = (i == 0); q < pw; q++)
+            {
+                const T* src = in + i*ld + q;
+                for (size_t j = 0; j < ow; j++)
+                    out[j] = std::max(out[j], src[j*sw]);
+            }
+    }
+    else
+    {
+        std::fill(out, out+ow, T(0));
+        for (size_t i = 0; i < ph; i++)
+            for (size_t q = 0; q < pw; q++)
+            {
+                const T* src = in + i*ld + q;
+                for (size_t j = 0; j < ow; j++)
+                    out[j] += src[j*sw];
+            }
+        const T scale = T(1)/T(ph*pw);
+        for (size_t j = 0; j < ow; j++)
+            out[j] *= scale;
+    }
+}
+
+/* Transformadas 1D de Winograd F(M, 3). Cada una lee sus entradas con salto
+   ds y escribe con salto os:
+     input:  N valores de d -> Bt*d
+     kernel: 3 valores de g -> G*g
+     output: N valores de m -> At*m (M valores) */
+template<typename T>
+struct WinogradF2
+{
+    static constexpr size_t M = 2, N = 4;
+    static NN_ALWAYS_INLINE void input(const T* d, size_t ds, T* o, size_t os)
+    {
+        const T d0 = d[0], d1 = d[ds], d2 = d[2*ds], d3 = d[3*ds];
+        o[0] = d0 - d2;
+        o[os] = d1 + d2;
+        o[2*os] = d2 - d1;
+        o[3*os] = d1 - d3;
+    }
+    static NN_ALWAYS_INLINE void kernel(const T* g, size_t gs, T* o, size_t os)
+    {
+        const T g0 = g[0], g1 = g[gs], g2 = g[2*gs];
+        o[0] = g0;
+        o[os] = (g0 + g1 + g2)/2;
+        o[2*os] = (g0 - g1 + g2)/2;
+        o[3*os] = g2;
+    }
+    static NN_ALWAYS_INLINE void output(const T* m, size_t ms, T* o, size_t os)
+    {
+        const T m1 = m[ms], m2 = m[2*ms];
+        o[0] = m[0] + m1 + m2;
+        o[os] = m1 - m2 - m[3*ms];
+    }
+};
+
+template<typename T>
+struct WinogradF4
+{
+    static constexpr size_t M = 4, N = 6;
+    static NN_ALWAYS_INLINE void input(const T* d, size_t ds, T* o, size_t os)
+    {
+        const T d0 = d[0], d1 = d[ds], d2 = d[2*ds], d3 = d[3*ds], d4 = d[4*ds], d5 = d[5*ds];
+        const T a = d4 - 4*d2, b = d3 - 4*d1, c = d4 - d2, e = 2*(d3 - d1);
+        o[0] = 4*d0 - 5*d2 + d4;
+        o[os] = a + b;
+        o[2*os] = a - b;
+        o[3*os] = c + e;
+        o[4*os] = c - e;
+        o[5*os] = 4*d1 - 5*d3 + d5;
+    }
+    static NN_ALWAYS_INLINE void kernel(const T* g, size_t gs, T* o, size_t os)
+    {
+        const T g0 = g[0], g1 = g[gs], g2 = g[2*gs];
+        o[0] = g0/4;
+        o[os] = -(g0 + g1 + g2)/6;
+        o[2*os] = -(g0 - g1 + g2)/6;
+        o[3*os] = g0/24 + g1/12 + g2/6;
+        o[4*os] = g0/24 - g1/12 + g2/6;
+        o[5*os] = g2;
+    }
+    static NN_ALWAYS_INLINE void output(const T* m, size_t ms, T* o, size_t os)
+    {
+        const T m1 = m[ms], m2 = m[2*ms], m3 = m[3*ms], m4 = m[4*ms];
+        const T a = m1 + m2, b = m1 - m2, c = m3 + m4, e = m3 - m4;
+        o[0] = m[0] + a + c;
+        o[os] = b + 2*e;
+        o[2*os] = a + 4*c;
+        o[3*os] = b + 8*e + m[5*ms];
+    }
+};
+
+// U = G g Gt (N x N) a partir del kernel g (3 x 3, por filas)
+template<typename T, typename W>
+void winogradKernel(const T* g, T* U)
+{
+    constexpr size_t N = W::N;
+    T tmp[3*N];
+    for (size_t r = 0; r < 3; r++)
+        W::kernel(g + r*3, 1, tmp + r*N, 1);
+    for (size_t c = 0; c < N; c++)
+        W::kernel(tmp + c, N, U + c, N);
+}
+
+/* nt <= NN_WINOGRAD_STRIP teselas seguidas en una fila de teselas: salidas
+   out[0..M)[0..M*nt) a partir de in[0..N)[0..M*nt+2). in y out apuntan a la
+   esquina de la franja y ld es el salto entre filas de ambos. */
+template<typename T, typename W>
+void winogradStrip(const T* in, T* out, size_t ld, const T* U, size_t nt)
+{
+    constexpr size_t M = W::M, N = W::N, S = NN_WINOGRAD_STRIP;
+    T tmp[N*N*S]; // [fila][columna transformada][tesela]
+    T V[N*N*S];   // [fila transformada][columna transformada][tesela]
+    for (size_t r = 0; r < N; r++)
+    {
+        const T* src = in + r*ld;
+        for (size_t t = 0; t < nt; t++)
+            W::input(src + t*M, 1, tmp + r*N*S + t, S);
+    }
+    for (size_t c = 0; c < N; c++)
+        for (size_t t = 0; t < nt; t++)
+            W::input(tmp + c*S + t, N*S, V + c*S + t, N*S);
+    for (size_t k = 0; k < N*N; k++)
+    {
+        const T u = U[k];
+        T* v = V + k*S;
+        for (size_t t = 0; t < nt; t++)
+            v[t] *= u;
+    }
+    // Y = At V A: primero por filas (N x M) y luego por columnas
+    for (size_t r = 0; r < N; r++)
+        for (size_t t = 0; t < nt; t++)
+            W::output(V + r*N*S + t, S, tmp + r*M*S + t, S);
+    for (size_t c = 0; c < M; c++)
+        for (size_t t = 0; t < nt; t++)
+            W::output(tmp + c*S + t, M*S, out + t*M + c, ld);
+}
+
+/* Salidas [i0, i0+M*tr) x [j0, j0+M*tc) de una imagen con ld columnas y
+   kernel 3x3, por Winograd. Todas las teselas deben estar en el interior.
+   out empieza en la fila oy de la salida. */
+template<typename T, typename W>
+void winogradRegion(const T* in, T* out, size_t ld, const T* U, size_t i0, size_t tr, size_t j0, size_t tc, size_t oy = 0)
+{
+    constexpr size_t M = W::M, S = NN_WINOGRAD_STRIP;
+    for (size_t r = 0; r < tr; r++)
+    {
+        const size_t i = i0 + r*M;
+        for (size_t t = 0; t < tc; t += S)
+        {
+            const size_t j = j0 + t*M;
+            winogradStrip<T, W>(in + (i-1)*ld + (j-1), out + (i-oy)*ld + j, ld, U, std::min(S, tc-t));
+        }
+    }
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef __NN_NNFFT__
+#define __NN_NNFFT__
+
+#include <cstddef>
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/*
+    FFT radix-2 para la convolución de ConvLayer con kernels largos.
+
+    FFTPlan precalcula la permutación bit-reversal y los factores de giro de
+    una FFT compleja de n = 2^p puntos. RealFFTPlan hace la FFT de m = 2n
+    valores reales con una compleja de n (pares en la parte real, impares en
+    la imaginaria) y devuelve los n+1 coeficientes no redundantes.
+
+    La convolución circular de tamaño N >= filas (o columnas) de la imagen da
+    exactamente la correlación lineal en las salidas interiores: lo que da la
+    vuelta solo cae en las kh-1 primeras, que son borde. Así basta con la
+    siguiente potencia de dos del tamaño de la imagen.
+*/
+
+/* Coste de la convolución por FFT en productos-suma equivalentes por
+   N*log2(N) puntos de la rejilla (FFT directa, producto e inversa). Lo usa
+   ConvMethod::AUTO para compararla con el cálculo directo. */
+#ifndef NN_FFT_COST
+#define NN_FFT_COST 4.0
+#endif
+
+namespace NN{
+namespace kernels{
+
+inline size_t nextPow2(size_t n)
+{
+    size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+template<typename T>
+class FFTPlan
+{
+    private:
+        size_t _n = 1;
+        std::vector<size_t> _rev;
+        std::vector<std::complex<T>> _w; // e^{-2*pi*i*k/n}, k < n/2
+    public:
+        FFTPlan() = default;
+        explicit FFTPlan(size_t n) : _n(n), _rev(n), _w(n/2)
+        {
+            size_t bits = 0;
+            while ((size_t(1) << bits) < n)
+                ++bits;
+            for (size_t k = 0; k < n; k++)
+            {
+                size_t r = 0;
+                for (size_t b = 0; b < bits; b++)
+                    r |= ((k >> b) & 1) << (bits-1-b);
+                _rev[k] = r;
+            }
+            const double step = -2*M_PI/double(n);
+            for (size_t k = 0; k < n/2; k++)
+                _w[k] = std::complex<T>(T(std::cos(step*k)), T(std::sin(step*k)));
+        }
+        size_t size() const {return _n;}
+
+        // FFT en el sitio. La inversa no divide por n.
+        void transform(std::complex<T>* x, bool inverse) const
+        {
+            for (size_t k = 0; k < _n; k++)
+                if (k < _rev[k])
+                    std::swap(x[k], x[_rev[k]]);
+            for (size_t len = 2; len <= _n; len <<= 1)
+            {
+                const size_t half = len/2, stride = _n/len;
+                for (size_t s = 0; s < _n; s += len)
+                {
+                    for (size_t k = 0; k < half; k++)
+                    {
+                        std::complex<T> w = _w[k*stride];
+                        if (inverse)
+                            w = std::conj(w);
+                        const std::complex<T> a = x[s+k], b = x[s+k+half]*w;
+                        x[s+k] = a + b;
+                        x[s+k+half] = a - b;
+                    }
+                }
+            }
+        }
+};
+
+template<typename T>
+class RealFFTPlan
+{
+    private:
+        size_t _m = 2;
+        FFTPlan<T> _half;
+        std::vector<std::complex<T>> _w; // e^{-2*pi*i*k/m}, k <= m/2
+    public:
+        RealFFTPlan() = default;
+        explicit RealFFTPlan(size_t m) : _m(m), _half(m/2), _w(m/2+1)
+        {
+            const double step = -2*M_PI/double(m);
+            for (size_t k = 0; k <= m/2; k++)
+                _w[k] = std::complex<T>(T(std::cos(step*k)), T(std::sin(step*k)));
+        }
+        size_t size() const {return _m;}
+        size_t bins() const {return _m/2+1;}
+
+        // X[0..m/2] = FFT de x[0..m). z: m/2 complejos de trabajo.
+        void forward(const T* x, std::complex<T>* X, std::complex<T>* z) const
+        {
+            const size_t n = _m/2;
+            for (size_t k = 0; k < n; k++)
+                z[k] = std::complex<T>(x[2*k], x[2*k+1]);
+            _half.transform(z, false);
+            const std::complex<T> mi(0, -1);
+            for (size_t k = 0; k <= n; k++)
+            {
+                const std::complex<T> a = z[k == n ? 0 : k], b = std::conj(z[(n-k) % n]);
+                X[k] = (a + b)*T(0.5) + _w[k]*(a - b)*mi*T(0.5);
+            }
+        }
+        // x[0..m) = m * IFFT de X[0..m/2] (sin normalizar, como FFTPlan)
+        void inverse(const std::complex<T>* X, T* x, std::complex<T>* z) const
+        {
+            const size_t n = _m/2;
+            const std::complex<T> i1(0, 1);
+            for (size_t k = 0; k < n; k++)
+            {
+                const std::complex<T> a = X[k], b = std::conj(X[n-k]);
+                z[k] = (a + b) + (a - b)*std::conj(_w[k])*i1;
+            }
+            _half.transform(z, true);
+            for (size_t k = 0; k < n; k++)
+            {
+                x[2*k] = z[k].real();
+                x[2*k+1] = z[k].imag();
+            }
+        }
+};
+
+/* Correlación 2D por FFT sobre una rejilla de Nr x Nc (potencias de dos,
+   Nc >= 2). El espectro de una imagen se guarda como [Nr][Nc/2+1]. */
+template<typename T>
+class FFTConv
+{
+    private:
+        size_t _nr = 1, _nc = 2;
+        FFTPlan<T> _col;
+        RealFFTPlan<T> _row;
+        std::vector<std::complex<T>> _K; // Espectro del kernel volteado
+
+        struct Scratch
+        {
+            std::vector<std::complex<T>> spec, z, col;
+            std::vector<T> row;
+        };
+        Scratch& scratch() const
+        {
+            thread_local Scratch s;
+            const size_t h = _nc/2+1;
+            if (s.spec.size() < _nr*h)
+                s.spec.resize(_nr*h);
+            if (s.z.size() < _nc/2)
+                s.z.resize(_nc/2);
+            if (s.col.size() < _nr)
+                s.col.resize(_nr);
+            if (s.row.size() < _nc)
+                s.row.resize(_nc);
+            return s;
+        }
+        // Espectro de src[rows][cols] (salto ld) rellenado con ceros
+        void forward(const T* src, size_t rows, size_t cols, size_t ld, Scratch &s) const
+        {
+            const size_t h = _nc/2+1;
+            for (size_t r = 0; r < _nr; r++)
+            {
+                std::complex<T>* X = s.spec.data() + r*h;
+                if (r >= rows)
+                {
+                    std::fill(X, X+h, std::complex<T>(0));
+                    continue;
+                }
+                std::copy(src + r*ld, src + r*ld + cols, s.row.begin());
+                std::fill(s.row.begin()+cols, s.row.begin()+_nc, T(0));
+                _row.forward(s.row.data(), X, s.z.data());
+            }
+            columns(s, false);
+        }
+        void columns(Scratch &s, bool inverse) const
+        {
+            if (_nr == 1)
+                return;
+            const size_t h = _nc/2+1;
+            for (size_t c = 0; c < h; c++)
+            {
+                for (size_t r = 0; r < _nr; r++)
+                    s.col[r] = s.spec[r*h+c];
+                _col.transform(s.col.data(), inverse);
+                for (size_t r = 0; r < _nr; r++)
+                    s.spec[r*h+c] = s.col[r];
+            }
+        }
+    public:
+        FFTConv() = default;
+        // Rejilla para una imagen rows x cols
+        FFTConv(size_t rows, size_t cols) : _nr(nextPow2(rows)), _nc(std::max<size_t>(2, nextPow2(cols))), _col(_nr), _row(_nc) {}
+
+        size_t rows() const {return _nr;}
+        size_t cols() const {return _nc;}
+
+        // Guarda el espectro de k[kh][kw] volteado (correlación)
+        void setKernel(const T* k, size_t kh, size_t kw)
+        {
+            std::vector<T> flip(kh*kw);
+            for (size_t i = 0; i < kh; i++)
+                for (size_t j = 0; j < kw; j++)
+                    flip[i*kw+j] = k[(kh-1-i)*kw + (kw-1-j)];
+            Scratch &s = scratch();
+            forward(flip.data(), kh, kw, kw, s);
+            _K.assign(s.spec.begin(), s.spec.begin() + _nr*(_nc/2+1));
+        }
+
+        /* full[y][x] = sum k[ki][kj]*in[y-kh+1+ki][x-kw+1+kj] (correlación
+           circular en la rejilla) para y en [y0, y1), x en [x0, x1), escrito
+           en out[y-y0+oy][x-x0+ox] con salto ld. in es rows x cols con salto ld. */
+        void correlate(const T* in, size_t rows, size_t cols, T* out, size_t ld,
+                       size_t y0, size_t y1, size_t x0, size_t x1, size_t oy, size_t ox) const
+        {
+            Scratch &s = scratch();
+            const size_t h = _nc/2+1;
+            forward(in, rows, cols, ld, s);
+            for (size_t k = 0; k < _nr*h; k++)
+                s.spec[k] *= _K[k];
+            columns(s, true);
+            const T scale = T(1)/T(_nr*_nc);
+            for (size_t y = y0; y < y1; y++)
+            {
+                _row.inverse(s.spec.data() + y*h, s.row.data(), s.z.data());
+                T* dst = out + (y-y0+oy)*ld + ox;
+                for (size_t x = x0; x < x1; x++)
+                    dst[x-x0] = s.row[x]*scale;
+            }
+        }
+};
+
+}
+}
+
+#endif
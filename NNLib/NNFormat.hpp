@@ -0,0 +1,303 @@
+#ifndef __NN_NNFORMAT__
+#define __NN_NNFORMAT__
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "NNLib.hpp"
+
+/*
+    Formato binario de red (.nnb), pensado para mapearse en memoria.
+
+        NN::saveNet(net, "model.nnb");
+        auto net = NN::loadNetBin<float>("model.nnb");
+
+    Estructura, todo en el orden de bytes de la máquina:
+        FileHeader (64 B) | LayerRecord (64 B) x n_layers | bloques de datos
+    Cada bloque (pesos, sesgo, pesos empaquetados, medias, desviaciones) empieza
+    en un offset múltiplo de NN_ALIGN. El cargador mapea el fichero con
+    MAP_PRIVATE y las capas apuntan directamente a la proyección: no hay copia
+    y las páginas se comparten en la caché entre procesos mientras no se
+    escriban. Si el fichero trae los pesos ya empaquetados para el mismo panel
+    de la GEMM tampoco se reempaquetan.
+*/
+
+namespace NN{
+
+namespace format{
+
+constexpr char MAGIC[4] = {'N', 'N', 'B', 'F'};
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t ENDIAN_MARK = 0x01020304;
+
+enum class LayerType : uint32_t
+{
+    WG = 1, NORMALIZE, RELU, SOFTMAX, SIGMOID
+};
+
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t type_size;  // sizeof(T)
+    uint32_t n_layers;
+    uint32_t inputs;
+    uint32_t outputs;
+    uint32_t reserved[9];
+};
+
+struct LayerRecord
+{
+    uint32_t type;
+    uint32_t size_i, size_o;
+    uint32_t mode;       // ActMode de SoftMax/Sigmoid
+    uint32_t nr;         // Ancho de panel de los pesos empaquetados (0: no hay)
+    uint32_t wfmt;       // WeightFormat de WG (los pesos se guardan en T)
+    uint64_t offset[3];  // WG: W, B, Wp. Normalize: M, S
+    uint64_t reserved1[2];
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes.");
+static_assert(sizeof(LayerRecord) == 64, "LayerRecord must be 64 bytes.");
+
+inline uint64_t alignOffset(uint64_t off)
+{
+    return (off + NN_ALIGN - 1)/NN_ALIGN*NN_ALIGN;
+}
+
+// Bloque de solo lectura con el contenido del fichero (mapeado o leído)
+class FileBlock
+{
+    private:
+        void* _data = nullptr;
+        size_t _len = 0;
+        bool _mapped = false;
+    public:
+        explicit FileBlock(const char* filename)
+        {
+            #ifdef NN_HAS_MMAP
+            int fd = open(filename, O_RDONLY);
+            if (fd < 0)
+                throw LoadError(std::string("Cannot open binary model file: ") + filename);
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                close(fd);
+                throw LoadError(std::string("Empty binary model file: ") + filename);
+            }
+            _len = st.st_size;
+            // Privado y escribible: getMutWeights() sigue funcionando (copia en escritura)
+            _data = mmap(nullptr, _len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (_data == MAP_FAILED)
+            {
+                _data = nullptr;
+                throw LoadError(std::string("Cannot map binary model file: ") + filename);
+            }
+            _mapped = true;
+            #else
+            FILE* f = fopen(filename, "rb");
+            if (!f)
+                throw LoadError(std::string("Cannot open binary model file: ") + filename);
+            fseek(f, 0L, SEEK_END);
+            _len = ftell(f);
+            rewind(f);
+            _data = ::operator new[](_len, std::align_val_t(NN_ALIGN));
+            if (fread(_data, 1, _len, f) != _len)
+            {
+                fclose(f);
+                ::operator delete[](_data, std::align_val_t(NN_ALIGN));
+                throw LoadError(std::string("Cannot read binary model file: ") + filename);
+            }
+            fclose(f);
+            #endif
+        }
+        FileBlock(const FileBlock&) = delete;
+        FileBlock& operator=(const FileBlock&) = delete;
+        ~FileBlock()
+        {
+            #ifdef NN_HAS_MMAP
+            if (_mapped)
+                munmap(_data, _len);
+            #else
+            ::operator delete[](_data, std::align_val_t(NN_ALIGN));
+            #endif
+        }
+        char* data() const {return static_cast<char*>(_data);}
+        size_t size() const {return _len;}
+};
+
+}
+
+template<typename T>
+void saveNet(const Net<T> &net, const char* filename)
+{
+    using namespace format;
+    const size_t n_layers = net.n_layers();
+    std::vector<LayerRecord> records(n_layers);
+    std::vector<std::pair<const T*, size_t>> blobs; // Bloques en orden de escritura
+    uint64_t off = alignOffset(sizeof(FileHeader) + n_layers*sizeof(LayerRecord));
+    auto place = [&](const T* data, size_t len){
+        blobs.emplace_back(data, len);
+        uint64_t at = off;
+        off = alignOffset(off + len*sizeof(T));
+        return at;
+    };
+
+    for (size_t k = 0; k < n_layers; k++)
+    {
+        auto layer = net.layer(k);
+        LayerRecord &rec = records[k];
+        std::memset(&rec, 0, sizeof(rec));
+        rec.size_i = layer->getInputSize();
+        rec.size_o = layer->getOutputSize();
+        if (auto wgptr = dynamic_cast<const WGLayer<T>*>(layer.get()))
+        {
+            rec.type = uint32_t(LayerType::WG);
+            rec.offset[0] = place(wgptr->getWeights(), size_t(rec.size_i)*rec.size_o);
+            rec.offset[1] = place(wgptr->getBias(), rec.size_o);
+            rec.wfmt = uint32_t(wgptr->getWeightFormat());
+            if (wgptr->getPackedWeights())
+            {
+                rec.nr = kernels::GemmBlock<T>::NR;
+                rec.offset[2] = place(wgptr->getPackedWeights(), kernels::packedSize<T>(rec.size_o, rec.size_i));
+            }
+        }
+        else if (auto nptr = dynamic_cast<const NormLayer<T>*>(layer.get()))
+        {
+            rec.type = uint32_t(LayerType::NORMALIZE);
+            rec.offset[0] = place(nptr->getMeans(), rec.size_i);
+            rec.offset[1] = place(nptr->getSD(), rec.size_i);
+        }
+        else if (dynamic_cast<const ReLuLayer<T>*>(layer.get()))
+            rec.type = uint32_t(LayerType::RELU);
+        else if (auto smptr = dynamic_cast<const SoftMaxLayer<T>*>(layer.get()))
+        {
+            rec.type = uint32_t(LayerType::SOFTMAX);
+            rec.mode = uint32_t(smptr->getMode());
+        }
+        else if (auto sptr = dynamic_cast<const SigmoidLayer<T>*>(layer.get()))
+        {
+            rec.type = uint32_t(LayerType::SIGMOID);
+            rec.mode = uint32_t(sptr->getMode());
+        }
+        else
+            throw LoadError(std::string("Layer type not supported by the binary format: ") + layer->id());
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.endian = ENDIAN_MARK;
+    header.type_size = sizeof(T);
+    header.n_layers = n_layers;
+    header.inputs = net.getInputSize();
+    header.outputs = n_layers ? net.tail()->getOutputSize() : 0;
+
+    FILE* f = fopen(filename, "wb");
+    if (!f)
+        throw LoadError(std::string("Cannot create binary model file: ") + filename);
+    static const char zeros[NN_ALIGN] = {};
+    uint64_t pos = 0;
+    auto write = [&](const void* data, size_t len){
+        if (len && fwrite(data, 1, len, f) != len)
+        {
+            fclose(f);
+            throw LoadError(std::string("Cannot write binary model file: ") + filename);
+        }
+        pos += len;
+    };
+    auto pad = [&](){write(zeros, alignOffset(pos) - pos);};
+
+    write(&header, sizeof(header));
+    write(records.data(), records.size()*sizeof(LayerRecord));
+    for (auto &blob : blobs)
+    {
+        pad();
+        write(blob.first, blob.second*sizeof(T));
+    }
+    pad();
+    fclose(f);
+}
+
+template<typename T>
+Net<T> loadNetBin(const char* filename)
+{
+    using namespace format;
+    auto file = std::make_shared<FileBlock>(filename);
+    const char* base = file->data();
+    const size_t len = file->size();
+
+    if (len < sizeof(FileHeader))
+        throw LoadError("Corrupted binary model file.");
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(base);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw LoadError("Not a binary model file.");
+    if (header->version != VERSION)
+        throw LoadError("Unsupported binary model file version.");
+    if (header->endian != ENDIAN_MARK || header->type_size != sizeof(T))
+        throw LoadError("Binary model file was written for another data type or byte order.");
+    if (len < sizeof(FileHeader) + size_t(header->n_layers)*sizeof(LayerRecord))
+        throw LoadError("Corrupted binary model file.");
+    if (header->inputs == 0 || header->inputs > UINT16_MAX)
+        throw LoadError("Inconsistent interlayer dimensions.");
+
+    // Bloque dentro del fichero; comparte la vida de la proyección
+    auto block = [&](uint64_t off, size_t n){
+        if (off % NN_ALIGN != 0 || off > len || n*sizeof(T) > len - off)
+            throw LoadError("Corrupted binary model file.");
+        return std::shared_ptr<T>(file, reinterpret_cast<T*>(file->data() + off));
+    };
+
+    Net<T> net(header->inputs);
+    const LayerRecord* records = reinterpret_cast<const LayerRecord*>(base + sizeof(FileHeader));
+    size_t width = header->inputs;
+    for (size_t k = 0; k < header->n_layers; k++)
+    {
+        const LayerRecord &rec = records[k];
+        if (rec.size_i != width || rec.size_o == 0 || rec.size_o > UINT16_MAX)
+            throw LoadError("Inconsistent interlayer dimensions.");
+        if (rec.mode > uint32_t(ActMode::LUT) || rec.wfmt > uint32_t(WeightFormat::BF16))
+            throw LoadError("Corrupted binary model file.");
+        switch (LayerType(rec.type))
+        {
+        case LayerType::WG:
+        {
+            std::shared_ptr<T> wp;
+            if (rec.nr == kernels::GemmBlock<T>::NR)
+                wp = block(rec.offset[2], kernels::packedSize<T>(rec.size_o, rec.size_i));
+            net.addWGLayer(rec.size_o, block(rec.offset[0], size_t(rec.size_i)*rec.size_o), block(rec.offset[1], rec.size_o), wp);
+            if (rec.wfmt != uint32_t(WeightFormat::NATIVE))
+                std::dynamic_pointer_cast<WGLayer<T>>(net.tail())->setWeightFormat(WeightFormat(rec.wfmt));
+            break;
+        }
+        case LayerType::NORMALIZE:
+            net.addNormLayer(block(rec.offset[0], rec.size_i), block(rec.offset[1], rec.size_i));
+            break;
+        case LayerType::RELU:
+            net.addReLuLayer();
+            break;
+        case LayerType::SOFTMAX:
+            net.addSoftMaxLayer();
+            std::dynamic_pointer_cast<SoftMaxLayer<T>>(net.tail())->setMode(ActMode(rec.mode));
+            break;
+        case LayerType::SIGMOID:
+            net.addSigmoidLayer();
+            std::dynamic_pointer_cast<SigmoidLayer<T>>(net.tail())->setMode(ActMode(rec.mode));
+            break;
+        default:
+            throw LoadError("Unknown layer type in binary model file.");
+        }
+        width = net.tail()->getOutputSize();
+    }
+    if (header->n_layers && width != header->outputs)
+        throw LoadError("Inconsistent interlayer dimensions.");
+    return net;
+}
+
+}
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef __NN_NNHALF__
+#define __NN_NNHALF__
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include "NNUtils.hpp"
+#include "NNKernels.hpp"
+
+/*
+    Pesos de WGLayer guardados en 16 bits (IEEE fp16 o bfloat16).
+
+    Solo cambia el almacenamiento: los núcleos convierten cada grupo de pesos a
+    float en registro (F16C en x86) y acumulan en float, así que una GEMV
+    limitada por el ancho de banda lee la mitad de bytes. fp16 conserva 11 bits
+    de mantisa con rango hasta 65504; bf16 conserva el rango de float con 8.
+*/
+
+// Bytes de pesos convertidos a T que se reutilizan en un lote
+#ifndef NN_HALF_TILE_BYTES
+#define NN_HALF_TILE_BYTES (1 << 15)
+#endif
+
+namespace NN{
+namespace kernels{
+
+inline uint32_t floatBits(float f) {uint32_t u; std::memcpy(&u, &f, 4); return u;}
+inline float bitsFloat(uint32_t u) {float f; std::memcpy(&f, &u, 4); return f;}
+
+// float -> fp16 redondeando al par más cercano
+inline uint16_t toFP16(float f)
+{
+    uint32_t x = floatBits(f);
+    const uint16_t sign = (x >> 16) & 0x8000;
+    x &= 0x7fffffff;
+    if (x >= 0x7f800000) // Inf o NaN
+        return sign | (x > 0x7f800000 ? 0x7e00 : 0x7c00);
+    if (x >= 0x477ff000) // Redondea a >= 65520: desborda
+        return sign | 0x7c00;
+    if (x < 0x38800000) // Subnormal en fp16 (< 2^-14)
+        return sign | uint16_t(std::nearbyint(bitsFloat(x)*16777216.0f));
+    x += 0xc8000fff + ((x >> 13) & 1); // Reajusta el exponente y redondea
+    return sign | uint16_t(x >> 13);
+}
+inline float fromFP16(uint16_t h)
+{
+    const uint32_t sign = uint32_t(h & 0x8000) << 16;
+    const uint32_t e = (h >> 10) & 0x1f, m = h & 0x3ff;
+    if (e == 0)
+        return bitsFloat(sign | floatBits(std::ldexp(float(m), -24)));
+    if (e == 31)
+        return bitsFloat(sign | 0x7f800000 | (m << 13));
+    return bitsFloat(sign | ((e + 112) << 23) | (m << 13));
+}
+
+// float -> bf16 redondeando al par más cercano
+inline uint16_t toBF16(float f)
+{
+    uint32_t x = floatBits(f);
+    if ((x & 0x7fffffff) > 0x7f800000)
+        return uint16_t((x >> 16) | 0x40);
+    x += 0x7fff + ((x >> 16) & 1);
+    return uint16_t(x >> 16);
+}
+inline float fromBF16(uint16_t h) {return bitsFloat(uint32_t(h) << 16);}
+
+inline float fromHalf(uint16_t h, WeightFormat fmt)
+{
+    return fmt == WeightFormat::BF16 ? fromBF16(h) : fromFP16(h);
+}
+
+template<typename T>
+void toHalf(const T* src, uint16_t* dst, size_t n, WeightFormat fmt)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = fmt == WeightFormat::BF16 ? toBF16(float(src[i])) : toFP16(float(src[i]));
+}
+
+// y = W*x + B con W[rows][cols] en 16 bits. Versión escalar de referencia.
+template<typename T>
+void gemvHalfRef(const uint16_t* W, WeightFormat fmt, const T* B, const T* x, T* y, size_t rows, size_t cols, Epilogue ep)
+{
+    for (size_t i = 0; i < rows; i++)
+    {
+        const uint16_t* w = W + i*cols;
+        T acc = B[i];
+        for (size_t j = 0; j < cols; j++)
+            acc += T(fromHalf(w[j], fmt))*x[j];
+        y[i] = epilogue(acc, ep);
+    }
+}
+
+template<typename T>
+void halfToFloatRef(const uint16_t* src, WeightFormat fmt, T* dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = T(fromHalf(src[i], fmt));
+}
+
+#ifdef NN_X86_DISPATCH
+
+template<WeightFormat F>
+NN_TARGET("avx2,fma,f16c") NN_ALWAYS_INLINE __m256 loadHalf8(const uint16_t* p)
+{
+    const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if (F == WeightFormat::FP16)
+        return _mm256_cvtph_ps(h);
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+}
+
+template<WeightFormat F>
+NN_TARGET("avx2,fma,f16c") void gemvHalfAVX2(const uint16_t* W, const float* B, const float* x, float* y, size_t rows, size_t cols, Epilogue ep)
+{
+    const size_t cv = cols & ~size_t(7);
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const uint16_t* w = W + i*cols;
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps(), a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        for (size_t j = 0; j < cv; j += 8)
+        {
+            __m256 xv = _mm256_loadu_ps(x+j);
+            a0 = _mm256_fmadd_ps(loadHalf8<F>(w+j), xv, a0);
+            a1 = _mm256_fmadd_ps(loadHalf8<F>(w+cols+j), xv, a1);
+            a2 = _mm256_fmadd_ps(loadHalf8<F>(w+2*cols+j), xv, a2);
+            a3 = _mm256_fmadd_ps(loadHalf8<F>(w+3*cols+j), xv, a3);
+        }
+        float r[4] = {hsum(a0), hsum(a1), hsum(a2), hsum(a3)};
+        for (size_t j = cv; j < cols; j++)
+            for (size_t k = 0; k < 4; k++)
+                r[k] += fromHalf(w[k*cols+j], F)*x[j];
+        for (size_t k = 0; k < 4; k++)
+            y[i+k] = epilogue(B[i+k] + r[k], ep);
+    }
+    for (; i < rows; i++)
+    {
+        const uint16_t* w = W + i*cols;
+        __m256 a0 = _mm256_setzero_ps();
+        for (size_t j = 0; j < cv; j += 8)
+            a0 = _mm256_fmadd_ps(loadHalf8<F>(w+j), _mm256_loadu_ps(x+j), a0);
+        float r = hsum(a0);
+        for (size_t j = cv; j < cols; j++)
+            r += fromHalf(w[j], F)*x[j];
+        y[i] = epilogue(B[i] + r, ep);
+    }
+}
+
+template<WeightFormat F>
+NN_TARGET("avx512f,avx512bw,avx512vl") NN_ALWAYS_INLINE __m512 loadHalf16(__mmask16 m, const uint16_t* p)
+{
+    // Conversiones también enmascaradas (mismo resultado): las sin máscara dan -Wmaybe-uninitialized en GCC 12
+    const __m256i h = _mm256_maskz_loadu_epi16(m, p);
+    if (F == WeightFormat::FP16)
+        return _mm512_maskz_cvtph_ps(m, h);
+    return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(m, _mm512_maskz_cvtepu16_epi32(m, h), 16));
+}
+
+// La cola de cada fila se lee con cargas enmascaradas (AVX-512 BW/VL)
+template<WeightFormat F>
+NN_TARGET("avx512f,avx512bw,avx512vl") void gemvHalfAVX512(const uint16_t* W, const float* B, const float* x, float* y, size_t rows, size_t cols, Epilogue ep)
+{
+    const size_t cv = cols & ~size_t(15);
+    const __mmask16 tail = (__mmask16)((1u << (cols-cv)) - 1);
+    const __mmask16 full = 0xffff;
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const uint16_t* w = W + i*cols;
+        __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps(), a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+        for (size_t j = 0; j < cv; j += 16)
+        {
+            __m512 xv = _mm512_loadu_ps(x+j);
+            a0 = _mm512_fmadd_ps(loadHalf16<F>(full, w+j), xv, a0);
+            a1 = _mm512_fmadd_ps(loadHalf16<F>(full, w+cols+j), xv, a1);
+            a2 = _mm512_fmadd_ps(loadHalf16<F>(full, w+2*cols+j), xv, a2);
+            a3 = _mm512_fmadd_ps(loadHalf16<F>(full, w+3*cols+j), xv, a3);
+        }
+        if (tail)
+        {
+            __m512 xv = _mm512_maskz_loadu_ps(tail, x+cv);
+            a0 = _mm512_fmadd_ps(loadHalf16<F>(tail, w+cv), xv, a0);
+            a1 = _mm512_fmadd_ps(loadHalf16<F>(tail, w+cols+cv), xv, a1);
+            a2 = _mm512_fmadd_ps(loadHalf16<F>(tail, w+2*cols+cv), xv, a2);
+            a3 = _mm512_fmadd_ps(loadHalf16<F>(tail, w+3*cols+cv), xv, a3);
+        }
+        y[i]   = epilogue(B[i]   + hsum(a0), ep);
+        y[i+1] = epilogue(B[i+1] + hsum(a1), ep);
+        y[i+2] = epilogue(B[i+2] + hsum(a2), ep);
+        y[i+3] = epilogue(B[i+3] + hsum(a3), ep);
+    }
+    for (; i < rows; i++)
+    {
+        const uint16_t* w = W + i*cols;
+        __m512 a0 = _mm512_setzero_ps();
+        for (size_t j = 0; j < cv; j += 16)
+            a0 = _mm512_fmadd_ps(loadHalf16<F>(full, w+j), _mm512_loadu_ps(x+j), a0);
+        if (tail)
+            a0 = _mm512_fmadd_ps(loadHalf16<F>(tail, w+cv), _mm512_maskz_loadu_ps(tail, x+cv), a0);
+        y[i] = epilogue(B[i] + hsum(a0), ep);
+    }
+}
+
+template<WeightFormat F>
+NN_TARGET("avx2,fma,f16c") void halfToFloatAVX2(const uint16_t* src, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i+8 <= n; i += 8)
+        _mm256_storeu_ps(dst+i, loadHalf8<F>(src+i));
+    for (; i < n; i++)
+        dst[i] = fromHalf(src[i], F);
+}
+
+#endif
+
+/* Núcleo según el ISA activo. F16C acompaña a AVX2 en todas las CPUs que
+   conocemos, pero se comprueba igualmente. */
+inline void gemvHalf(const uint16_t* W, WeightFormat fmt, const float* B, const float* x, float* y, size_t rows, size_t cols, Epilogue ep = Epilogue::NONE)
+{
+#ifdef NN_X86_DISPATCH
+    static const bool f16c = __builtin_cpu_supports("f16c");
+    static const bool avx512bw = __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+    const ISA isa = activeISA();
+    if (isa == ISA::AVX512 && avx512bw)
+    {
+        if (fmt == WeightFormat::BF16)
+            gemvHalfAVX512<WeightFormat::BF16>(W, B, x, y, rows, cols, ep);
+        else
+            gemvHalfAVX512<WeightFormat::FP16>(W, B, x, y, rows, cols, ep);
+        return;
+    }
+    if ((isa == ISA::AVX2 || isa == ISA::AVX512) && f16c)
+    {
+        if (fmt == WeightFormat::BF16)
+            gemvHalfAVX2<WeightFormat::BF16>(W, B, x, y, rows, cols, ep);
+        else
+            gemvHalfAVX2<WeightFormat::FP16>(W, B, x, y, rows, cols, ep);
+        return;
+    }
+#endif
+    gemvHalfRef(W, fmt, B, x, y, rows, cols, ep);
+}
+inline void gemvHalf(const uint16_t* W, WeightFormat fmt, const double* B, const double* x, double* y, size_t rows, size_t cols, Epilogue ep = Epilogue::NONE)
+{
+    gemvHalfRef(W, fmt, B, x, y, rows, cols, ep);
+}
+
+// dst[n] = src[n] convertido a T
+inline void halfToFloat(const uint16_t* src, WeightFormat fmt, float* dst, size_t n)
+{
+#ifdef NN_X86_DISPATCH
+    static const bool f16c = __builtin_cpu_supports("f16c");
+    const ISA isa = activeISA();
+    if ((isa == ISA::AVX2 || isa == ISA::AVX512) && f16c)
+    {
+        if (fmt == WeightFormat::BF16)
+            halfToFloatAVX2<WeightFormat::BF16>(src, dst, n);
+        else
+            halfToFloatAVX2<WeightFormat::FP16>(src, dst, n);
+        return;
+    }
+#endif
+    halfToFloatRef(src, fmt, dst, n);
+}
+inline void halfToFloat(const uint16_t* src, WeightFormat fmt, double* dst, size_t n)
+{
+    halfToFloatRef(src, fmt, dst, n);
+}
+
+}
+}
+
+#endif
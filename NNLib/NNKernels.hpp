@@ -0,0 +1,750 @@
+#ifndef __NN_NNKERNELS__
+#define __NN_NNKERNELS__
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include "NNUtils.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NN_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NN_ALWAYS_INLINE inline __attribute__((always_inline))
+#define NN_TARGET(isa) __attribute__((target(isa)))
+#else
+#define NN_ALWAYS_INLINE inline
+#define NN_TARGET(isa)
+#endif
+
+/*
+    Núcleos de cálculo de las capas. Todas las funciones trabajan sobre
+    bloques de memoria contiguos y no dependen de las clases de capa.
+*/
+
+#ifndef NN_GEMM_MIN_BATCH
+#define NN_GEMM_MIN_BATCH 4 // Por debajo de este lote se usa GEMV por muestra
+#endif
+
+namespace NN{
+namespace kernels{
+
+/* Tamaños de bloque de la GEMM.
+   - MR x NR: bloque de registros del micro-kernel (muestras x salidas).
+   - KC: profundidad del bloque, el panel KCxNR de pesos cabe en L1.
+   - MC: muestras por bloque, el panel MCxKC de entradas cabe en L2. */
+template<typename T>
+struct GemmBlock
+{
+    static constexpr size_t MR = 4;
+    static constexpr size_t NR = 64/sizeof(T);
+    static constexpr size_t KC = 256;
+    static constexpr size_t MC = 64;
+};
+
+// Tamaño en elementos de la matriz de pesos empaquetada.
+template<typename T>
+size_t packedSize(size_t rows, size_t cols)
+{
+    constexpr size_t NR = GemmBlock<T>::NR;
+    return (rows+NR-1)/NR*NR*cols;
+}
+
+/* Empaqueta W[rows][cols] en paneles de NR filas. Dentro de cada panel los
+   datos se guardan por columnas: Wp[(p*cols+k)*NR+r] = W[p*NR+r][k].
+   Las filas que faltan en el último panel se rellenan con ceros. */
+template<typename T>
+void packWeights(const T* W, size_t rows, size_t cols, T* Wp)
+{
+    constexpr size_t NR = GemmBlock<T>::NR;
+    const size_t panels = (rows+NR-1)/NR;
+    for (size_t p = 0; p < panels; p++)
+    {
+        for (size_t k = 0; k < cols; k++)
+        {
+            T* dst = Wp + (p*cols+k)*NR;
+            for (size_t r = 0; r < NR; r++)
+            {
+                size_t row = p*NR+r;
+                dst[r] = row < rows ? W[row*cols+k] : T(0);
+            }
+        }
+    }
+}
+
+/* Epílogo aplicado al escribir cada salida, con el valor aún en registro.
+   Aquí solo se resuelve ReLu; sigmoide y softmax necesitan exp vectorial y
+   las aplica WGLayer sobre la fila recién escrita (NNMath). */
+template<typename T>
+NN_ALWAYS_INLINE T epilogue(T v, Epilogue ep)
+{
+    return (ep == Epilogue::RELU && v < T(0)) ? T(0) : v;
+}
+
+// y = W*x + B, con W[rows][cols] por filas. Versión escalar de referencia.
+template<typename T>
+void gemvRef(const T* W, const T* B, const T* x, T* y, size_t rows, size_t cols, Epilogue ep = Epilogue::NONE)
+{
+    for (size_t i = 0; i < rows; i++)
+    {
+        const T* w = W + i*cols;
+        T acc = B[i];
+        for (size_t j = 0; j < cols; j++)
+        {
+            acc += w[j]*x[j];
+        }
+        y[i] = epilogue(acc, ep);
+    }
+}
+
+/* Micro-kernel MRxNR: acumula en registros el producto de un panel de
+   entradas (kc x MR) por un panel de pesos (kc x NR). */
+template<typename T>
+NN_ALWAYS_INLINE void gemmMicroKernel(size_t kc, const T* a, const T* b, T* c)
+{
+    constexpr size_t MR = GemmBlock<T>::MR;
+    constexpr size_t NR = GemmBlock<T>::NR;
+    T acc[MR*NR] = {};
+    for (size_t k = 0; k < kc; k++)
+    {
+        const T* bk = b + k*NR;
+        const T* ak = a + k*MR;
+        #pragma GCC unroll 4
+        for (size_t r = 0; r < MR; r++)
+        {
+            #pragma GCC unroll 16
+            for (size_t j = 0; j < NR; j++)
+            {
+                acc[r*NR+j] += ak[r]*bk[j];
+            }
+        }
+    }
+    std::copy(acc, acc+MR*NR, c);
+}
+
+/* Y[n][rows] = X[n][cols] * W^T + B, con W empaquetada por packWeights.
+   Las filas de Y están separadas ldy elementos (ldy = rows salvo al calcular
+   solo un grupo de paneles de salida).
+   Bloqueo por caché: KC sobre la dimensión común, MC sobre las muestras.
+   Se fuerza inline para que cada versión de ISA lo compile con sus instrucciones. */
+template<typename T>
+NN_ALWAYS_INLINE void gemmImpl(const T* Wp, const T* B, const T* X, T* Y, size_t n, size_t rows, size_t cols, size_t ldy, Epilogue ep)
+{
+    constexpr size_t MR = GemmBlock<T>::MR;
+    constexpr size_t NR = GemmBlock<T>::NR;
+    constexpr size_t KC = GemmBlock<T>::KC;
+    constexpr size_t MC = GemmBlock<T>::MC;
+
+    thread_local std::vector<T> xpack;
+    if (xpack.size() < MC*KC)
+        xpack.resize(MC*KC);
+    T* Xp = xpack.data();
+    T c[MR*NR];
+
+    const size_t panels = (rows+NR-1)/NR;
+    for (size_t k0 = 0; k0 < cols; k0 += KC)
+    {
+        const size_t kc = std::min(KC, cols-k0);
+        const bool first = k0 == 0, last = k0+kc == cols;
+        for (size_t m0 = 0; m0 < n; m0 += MC)
+        {
+            const size_t mc = std::min(MC, n-m0);
+            const size_t mpanels = (mc+MR-1)/MR;
+
+            // Empaquetado de las entradas en paneles de MR muestras
+            for (size_t mp = 0; mp < mpanels; mp++)
+            {
+                for (size_t k = 0; k < kc; k++)
+                {
+                    T* dst = Xp + (mp*kc+k)*MR;
+                    for (size_t r = 0; r < MR; r++)
+                    {
+                        size_t m = mp*MR+r;
+                        dst[r] = m < mc ? X[(m0+m)*cols+k0+k] : T(0);
+                    }
+                }
+            }
+
+            for (size_t p = 0; p < panels; p++)
+            {
+                const T* wp = Wp + (p*cols+k0)*NR;
+                const size_t o0 = p*NR;
+                const size_t nr = std::min(NR, rows-o0);
+                for (size_t mp = 0; mp < mpanels; mp++)
+                {
+                    gemmMicroKernel<T>(kc, Xp + mp*kc*MR, wp, c);
+                    const size_t mr = std::min(MR, mc-mp*MR);
+                    for (size_t r = 0; r < mr; r++)
+                    {
+                        T* y = Y + (m0+mp*MR+r)*ldy + o0;
+                        if (first && last)
+                            for (size_t j = 0; j < nr; j++)
+                                y[j] = epilogue(B[o0+j] + c[r*NR+j], ep);
+                        else if (first)
+                            for (size_t j = 0; j < nr; j++)
+                                y[j] = B[o0+j] + c[r*NR+j];
+                        else if (last)
+                            for (size_t j = 0; j < nr; j++)
+                                y[j] = epilogue(y[j] + c[r*NR+j], ep);
+                        else
+                            for (size_t j = 0; j < nr; j++)
+                                y[j] += c[r*NR+j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<typename T>
+void gemmRef(const T* Wp, const T* B, const T* X, T* Y, size_t n, size_t rows, size_t cols, size_t ldy, Epilogue ep)
+{
+    gemmImpl(Wp, B, X, Y, n, rows, cols, ldy, ep);
+}
+
+/* Convolución directa sin bordes: out[i][j] = sum k[ki][kj]*in[i-ci+ki][j-cj+kj]
+   (ci = kh/2, cj = kw/2) para i en [i0, i1), j en [j0, j1), con salto ld en
+   in y out. out empieza en la fila oy de la salida (out[i-oy][j]), para poder
+   escribir una banda de filas en un buffer propio. Toda la región debe leer
+   dentro de la imagen: no hay comprobaciones.
+   Cada fila se recorre en bloques de V columnas de salida acumulados en
+   registros, que el compilador vectoriza. KH, KW != 0 fijan el tamaño del
+   kernel en compilación (3x3 y 5x5) para desenrollar los bucles del kernel. */
+template<typename T, size_t KH = 0, size_t KW = 0>
+NN_ALWAYS_INLINE void convRegion(const T* in, T* out, size_t ld, const T* k, size_t kh, size_t kw, size_t i0, size_t i1, size_t j0, size_t j1, size_t oy)
+{
+    constexpr size_t V = 64/sizeof(T); // Columnas de salida por bloque de registros
+    const size_t H = KH ? KH : kh, W = KW ? KW : kw;
+    for (size_t i = i0; i < i1; i++)
+    {
+        const T* src = in + (i-H/2)*ld - W/2;
+        T* dst = out + (i-oy)*ld;
+        size_t j = j0;
+        for (; j + V <= j1; j += V)
+        {
+            T acc[V] = {};
+            for (size_t ki = 0; ki < H; ki++)
+            {
+                #pragma GCC unroll 5
+                for (size_t kj = 0; kj < W; kj++)
+                {
+                    const T* s = src + ki*ld + j + kj;
+                    const T w = k[ki*W+kj];
+                    #pragma GCC unroll 16
+                    for (size_t v = 0; v < V; v++)
+                        acc[v] += s[v]*w;
+                }
+            }
+            std::copy(acc, acc+V, dst+j);
+        }
+        for (; j < j1; j++)
+        {
+            T acc = 0;
+            for (size_t ki = 0; ki < H; ki++)
+                for (size_t kj = 0; kj < W; kj++)
+                    acc += src[ki*ld+j+kj]*k[ki*W+kj];
+            dst[j] = acc;
+        }
+    }
+}
+
+template<typename T>
+NN_ALWAYS_INLINE void convImpl(const T* in, T* out, size_t ld, const T* k, size_t kh, size_t kw, size_t i0, size_t i1, size_t j0, size_t j1, size_t oy)
+{
+    if (kh == 3 && kw == 3)
+        convRegion<T, 3, 3>(in, out, ld, k, kh, kw, i0, i1, j0, j1, oy);
+    else if (kh == 5 && kw == 5)
+        convRegion<T, 5, 5>(in, out, ld, k, kh, kw, i0, i1, j0, j1, oy);
+    else
+        convRegion<T>(in, out, ld, k, kh, kw, i0, i1, j0, j1, oy);
+}
+
+template<typename T>
+void convRef(const T* in, T* out, size_t ld, const T* k, size_t kh, size_t kw, size_t i0, size_t i1, size_t j0, size_t j1, size_t oy)
+{
+    convImpl(in, out, ld, k, kh, kw, i0, i1, j0, j1, oy);
+}
+
+/*
+    Selección de instrucciones en tiempo de ejecución.
+
+    El mismo binario puede ejecutarse en CPUs distintas, así que las versiones
+    vectoriales se compilan con atributos target y se elige una mediante CPUID
+    la primera vez que se usa (Net::init() fuerza esa elección).
+
+    Tolerancia: las versiones vectoriales reparten la suma en varios
+    acumuladores, por lo que el resultado no es idéntico bit a bit al escalar.
+    La diferencia está acotada por |y_simd - y_ref| <= 2*cols*eps*sum|w_j*x_j|
+    (eps = épsilon de T). En la práctica es del orden de 1e-6 relativo en float.
+*/
+enum class ISA : char
+{
+    SCALAR = 0,
+    SSE42,
+    AVX2,
+    AVX512
+};
+
+inline const char* isaName(ISA isa)
+{
+    switch (isa)
+    {
+    case ISA::SSE42:  return "SSE4.2";
+    case ISA::AVX2:   return "AVX2";
+    case ISA::AVX512: return "AVX-512";
+    default:          return "Scalar";
+    }
+}
+
+// Mejor conjunto de instrucciones disponible en la CPU actual.
+inline ISA detectISA()
+{
+#ifdef NN_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return ISA::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return ISA::AVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return ISA::SSE42;
+#endif
+    return ISA::SCALAR;
+}
+
+#ifdef NN_X86_DISPATCH
+
+NN_TARGET("sse4.2") inline float hsum(__m128 v)
+{
+    v = _mm_hadd_ps(v, v);
+    v = _mm_hadd_ps(v, v);
+    return _mm_cvtss_f32(v);
+}
+NN_TARGET("sse4.2") inline double hsum(__m128d v)
+{
+    return _mm_cvtsd_f64(_mm_hadd_pd(v, v));
+}
+NN_TARGET("avx2,fma") inline float hsum(__m256 v)
+{
+    return hsum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+NN_TARGET("avx2,fma") inline double hsum(__m256d v)
+{
+    return hsum(_mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+}
+/* Mitades de 256 bits con la extracción enmascarada: _mm512_reduce_add_* y los
+   cast de 512 a 256 dan -Wmaybe-uninitialized en GCC 12 con -Wall. */
+NN_TARGET("avx512f") inline double hsum(__m512d v)
+{
+    return hsum(_mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xF, v, 0), _mm512_maskz_extractf64x4_pd(0xF, v, 1)));
+}
+NN_TARGET("avx512f") inline float hsum(__m512 v)
+{
+    const __m512d d = _mm512_castps_pd(v);
+    return hsum(_mm256_add_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, d, 0)),
+                              _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, d, 1))));
+}
+
+/* Las GEMV vectoriales procesan 4 filas a la vez para reutilizar cada carga
+   de x, con un acumulador vectorial por fila y resto escalar. */
+
+NN_TARGET("sse4.2") inline void gemvSSE42(const float* W, const float* B, const float* x, float* y, size_t rows, size_t cols, Epilogue ep)
+{
+    const size_t cv = cols & ~size_t(3);
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const float* w = W + i*cols;
+        __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps(), a2 = _mm_setzero_ps(), a3 = _mm_setzero_ps();
+        for (size_t j = 0; j < cv; j += 4)
+        {
+            __m128 xv = _mm_loadu_ps(x+j);
+            a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(w+j), xv));
+            a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(w+cols+j), xv));
+            a2 = _mm_add_ps(a2, _mm_mul_ps(_mm_loadu_ps(w+2*cols+j), xv));
+            a3 = _mm_add_ps(a3, _mm_mul_ps(_mm_loadu_ps(w+3*cols+j), xv));
+        }
+        float r[4] = {hsum(a0), hsum(a1), hsum(a2), hsum(a3)};
+        for (size_t j = cv; j < cols; j++)
+            for (size_t k = 0; k < 4; k++)
+                r[k] += w[k*cols+j]*x[j];
+        for (size_t k = 0; k < 4; k++)
+            y[i+k] = epilogue(B[i+k] + r[k], ep);
+    }
+    for (; i < rows; i++)
+    {
+        const float* w = W + i*cols;
+        __m128 a0 = _mm_setzero_ps();
+        for (size_t j = 0; j < cv; j += 4)
+            a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(w+j), _mm_loadu_ps(x+j)));
+        float r = hsum(a0);
+        for (size_t j = cv; j < cols; j++)
+            r += w[j]*x[j];
+        y[i] = epilogue(B[i] + r, ep);
+    }
+}
+
+NN_TARGET("sse4.2") inline void gemvSSE42(const double* W, const double* B, const double* x, double* y, size_t rows, size_t cols, Epilogue ep)
+{
+    const size_t cv = cols & ~size_t(1);
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const double* w = W + i*cols;
+        __m128d a0 = _mm_setzero_pd(), a1 = _mm_setzero_pd(), a2 = _mm_setzero_pd(), a3 = _mm_setzero_pd();
+        for (size_t j = 0; j < cv; j += 2)
+        {
+            __m128d xv = _mm_loadu_pd(x+j);
+            a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(w+j), xv));
+            a1 = _mm_add_pd(a1, _mm_mul_pd(_mm_loadu_pd(w+cols+j), xv));
+            a2 = _mm_add_pd(a2, _mm_mul_pd(_mm_loadu_pd(w+2*cols+j), xv));
+            a3 = _mm_add_pd(a3, _mm_mul_pd(_mm_loadu_pd(w+3*cols+j), xv));
+        }
+        double r[4] = {hsum(a0), hsum(a1), hsum(a2), hsum(a3)};
+        for (size_t j = cv; j < cols; j++)
+            for (size_t k = 0; k < 4; k++)
+                r[k] += w[k*cols+j]*x[j];
+        for (size_t k = 0; k < 4; k++)
+            y[i+k] = epilogue(B[i+k] + r[k], ep);
+    }
+    for (; i < rows; i++)
+    {
+        const double* w = W + i*cols;
+        __m128d a0 = _mm_setzero_pd();
+        for (size_t j = 0; j < cv; j += 2)
+            a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(w+j), _mm_loadu_pd(x+j)));
+        double r = hsum(a0);
+        for (size_t j = cv; j < cols; j++)
+            r += w[j]*x[j];
+        y[i] = epilogue(B[i] + r, ep);
+    }
+}
+
+NN_TARGET("avx2,fma") inline void gemvAVX2(const float* W, const float* B, const float* x, float* y, size_t rows, size_t cols, Epilogue ep)
+{
+    const size_t cv = cols & ~size_t(7);
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const float* w = W + i*cols;
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps(), a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        for (size_t j = 0; j < cv; j += 8)
+        {
+            __m256 xv = _mm256_loadu_ps(x+j);
+            a0 = _mm256_fmadd_ps(_mm256_loadu_ps(w+j), xv, a0);
+            a1 = _mm256_fmadd_ps(_mm256_loadu_ps(w+cols+j), xv, a1);
+            a2 = _mm256_fmadd_ps(_mm256_loadu_ps(w+2*cols+j), xv, a2);
+            a3 = _mm256_fmadd_ps(_mm256_loadu_ps(w+3*cols+j), xv, a3);
+        }
+        float r[4] = {hsum(a0), hsum(a1), hsum(a2), hsum(a3)};
+        for (size_t j = cv; j < cols; j++)
+            for (size_t k = 0; k < 4; k++)
+                r[k] += w[k*cols+j]*x[j];
+        for (size_t k = 0; k < 4; k++)
+            y[i+k] = epilogue(B[i+k] + r[k], ep);
+    }
+    for (; i < rows; i++)
+    {
+        const float* w = W + i*cols;
+        __m256 a0 = _mm256_setzero_ps();
+        for (size_t j = 0; j < cv; j += 8)
+            a0 = _mm256_fmadd_ps(_mm256_loadu_ps(w+j), _mm256_loadu_ps(x+j), a0);
+        float r = hsum(a0);
+        for (size_t j = cv; j < cols; j++)
+            r += w[j]*x[j];
+        y[i] = epilogue(B[i] + r, ep);
+    }
+}
+
+NN_TARGET("avx2,fma") inline void gemvAVX2(const double* W, const double* B, const double* x, double* y, size_t rows, size_t cols, Epilogue ep)
+{
+    const size_t cv = cols & ~size_t(3);
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const double* w = W + i*cols;
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd(), a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+        for (size_t j = 0; j < cv; j += 4)
+        {
+            __m256d xv = _mm256_loadu_pd(x+j);
+            a0 = _mm256_fmadd_pd(_mm256_loadu_pd(w+j), xv, a0);
+            a1 = _mm256_fmadd_pd(_mm256_loadu_pd(w+cols+j), xv, a1);
+            a2 = _mm256_fmadd_pd(_mm256_loadu_pd(w+2*cols+j), xv, a2);
+            a3 = _mm256_fmadd_pd(_mm256_loadu_pd(w+3*cols+j), xv, a3);
+        }
+        double r[4] = {hsum(a0), hsum(a1), hsum(a2), hsum(a3)};
+        for (size_t j = cv; j < cols; j++)
+            for (size_t k = 0; k < 4; k++)
+                r[k] += w[k*cols+j]*x[j];
+        for (size_t k = 0; k < 4; k++)
+            y[i+k] = epilogue(B[i+k] + r[k], ep);
+    }
+    for (; i < rows; i++)
+    {
+        const double* w = W + i*cols;
+        __m256d a0 = _mm256_setzero_pd();
+        for (size_t j = 0; j < cv; j += 4)
+            a0 = _mm256_fmadd_pd(_mm256_loadu_pd(w+j), _mm256_loadu_pd(x+j), a0);
+        double r = hsum(a0);
+        for (size_t j = cv; j < cols; j++)
+            r += w[j]*x[j];
+        y[i] = epilogue(B[i] + r, ep);
+    }
+}
+
+// En AVX-512 el resto de cada fila se resuelve con cargas enmascaradas.
+NN_TARGET("avx512f") inline void gemvAVX512(const float* W, const float* B, const float* x, float* y, size_t rows, size_t cols, Epilogue ep)
+{
+    const size_t cv = cols & ~size_t(15);
+    const __mmask16 tail = (__mmask16)((1u << (cols-cv)) - 1);
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const float* w = W + i*cols;
+        __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps(), a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+        for (size_t j = 0; j < cv; j += 16)
+        {
+            __m512 xv = _mm512_loadu_ps(x+j);
+            a0 = _mm512_fmadd_ps(_mm512_loadu_ps(w+j), xv, a0);
+            a1 = _mm512_fmadd_ps(_mm512_loadu_ps(w+cols+j), xv, a1);
+            a2 = _mm512_fmadd_ps(_mm512_loadu_ps(w+2*cols+j), xv, a2);
+            a3 = _mm512_fmadd_ps(_mm512_loadu_ps(w+3*cols+j), xv, a3);
+        }
+        if (tail)
+        {
+            __m512 xv = _mm512_maskz_loadu_ps(tail, x+cv);
+            a0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w+cv), xv, a0);
+            a1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w+cols+cv), xv, a1);
+            a2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w+2*cols+cv), xv, a2);
+            a3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w+3*cols+cv), xv, a3);
+        }
+        y[i]   = epilogue(B[i]   + hsum(a0), ep);
+        y[i+1] = epilogue(B[i+1] + hsum(a1), ep);
+        y[i+2] = epilogue(B[i+2] + hsum(a2), ep);
+        y[i+3] = epilogue(B[i+3] + hsum(a3), ep);
+    }
+    for (; i < rows; i++)
+    {
+        const float* w = W + i*cols;
+        __m512 a0 = _mm512_setzero_ps();
+        for (size_t j = 0; j < cv; j += 16)
+            a0 = _mm512_fmadd_ps(_mm512_loadu_ps(w+j), _mm512_loadu_ps(x+j), a0);
+        if (tail)
+            a0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w+cv), _mm512_maskz_loadu_ps(tail, x+cv), a0);
+        y[i] = epilogue(B[i] + hsum(a0), ep);
+    }
+}
+
+NN_TARGET("avx512f") inline void gemvAVX512(const double* W, const double* B, const double* x, double* y, size_t rows, size_t cols, Epilogue ep)
+{
+    const size_t cv = cols & ~size_t(7);
+    const __mmask8 tail = (__mmask8)((1u << (cols-cv)) - 1);
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const double* w = W + i*cols;
+        __m512d a0 = _mm512_setzero_pd(), a1 = _mm512_setzero_pd(), a2 = _mm512_setzero_pd(), a3 = _mm512_setzero_pd();
+        for (size_t j = 0; j < cv; j += 8)
+        {
+            __m512d xv = _mm512_loadu_pd(x+j);
+            a0 = _mm512_fmadd_pd(_mm512_loadu_pd(w+j), xv, a0);
+            a1 = _mm512_fmadd_pd(_mm512_loadu_pd(w+cols+j), xv, a1);
+            a2 = _mm512_fmadd_pd(_mm512_loadu_pd(w+2*cols+j), xv, a2);
+            a3 = _mm512_fmadd_pd(_mm512_loadu_pd(w+3*cols+j), xv, a3);
+        }
+        if (tail)
+        {
+            __m512d xv = _mm512_maskz_loadu_pd(tail, x+cv);
+            a0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w+cv), xv, a0);
+            a1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w+cols+cv), xv, a1);
+            a2 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w+2*cols+cv), xv, a2);
+            a3 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w+3*cols+cv), xv, a3);
+        }
+        y[i]   = epilogue(B[i]   + hsum(a0), ep);
+        y[i+1] = epilogue(B[i+1] + hsum(a1), ep);
+        y[i+2] = epilogue(B[i+2] + hsum(a2), ep);
+        y[i+3] = epilogue(B[i+3] + hsum(a3), ep);
+    }
+    for (; i < rows; i++)
+    {
+        const double* w = W + i*cols;
+        __m512d a0 = _mm512_setzero_pd();
+        for (size_t j = 0; j < cv; j += 8)
+            a0 = _mm512_fmadd_pd(_mm512_loadu_pd(w+j), _mm512_loadu_pd(x+j), a0);
+        if (tail)
+            a0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w+cv), _mm512_maskz_loadu_pd(tail, x+cv), a0);
+        y[i] = epilogue(B[i] + hsum(a0), ep);
+    }
+}
+
+// La GEMM genérica recompilada para cada ISA (el compilador vectoriza el micro-kernel).
+template<typename T>
+NN_TARGET("sse4.2") void gemmSSE42(const T* Wp, const T* B, const T* X, T* Y, size_t n, size_t rows, size_t cols, size_t ldy, Epilogue ep)
+{
+    gemmImpl(Wp, B, X, Y, n, rows, cols, ldy, ep);
+}
+template<typename T>
+NN_TARGET("avx2,fma") void gemmAVX2(const T* Wp, const T* B, const T* X, T* Y, size_t n, size_t rows, size_t cols, size_t ldy, Epilogue ep)
+{
+    gemmImpl(Wp, B, X, Y, n, rows, cols, ldy, ep);
+}
+template<typename T>
+NN_TARGET("avx512f") void gemmAVX512(const T* Wp, const T* B, const T* X, T* Y, size_t n, size_t rows, size_t cols, size_t ldy, Epilogue ep)
+{
+    gemmImpl(Wp, B, X, Y, n, rows, cols, ldy, ep);
+}
+
+// Igual con la convolución directa
+template<typename T>
+NN_TARGET("sse4.2") void convSSE42(const T* in, T* out, size_t ld, const T* k, size_t kh, size_t kw, size_t i0, size_t i1, size_t j0, size_t j1, size_t oy)
+{
+    convImpl(in, out, ld, k, kh, kw, i0, i1, j0, j1, oy);
+}
+template<typename T>
+NN_TARGET("avx2,fma") void convAVX2(const T* in, T* out, size_t ld, const T* k, size_t kh, size_t kw, size_t i0, size_t i1, size_t j0, size_t j1, size_t oy)
+{
+    convImpl(in, out, ld, k, kh, kw, i0, i1, j0, j1, oy);
+}
+template<typename T>
+NN_TARGET("avx512f") void convAVX512(const T* in, T* out, size_t ld, const T* k, size_t kh, size_t kw, size_t i0, size_t i1, size_t j0, size_t j1, size_t oy)
+{
+    convImpl(in, out, ld, k, kh, kw, i0, i1, j0, j1, oy);
+}
+
+#endif
+
+// Tabla de funciones activa para el tipo T.
+template<typename T>
+struct KernelTable
+{
+    ISA isa = ISA::SCALAR;
+    void (*gemv)(const T*, const T*, const T*, T*, size_t, size_t, Epilogue) = gemvRef<T>;
+    void (*gemm)(const T*, const T*, const T*, T*, size_t, size_t, size_t, size_t, Epilogue) = gemmRef<T>;
+    void (*conv)(const T*, T*, size_t, const T*, size_t, size_t, size_t, size_t, size_t, size_t, size_t) = convRef<T>;
+};
+
+template<typename T>
+KernelTable<T> makeKernelTable(ISA isa)
+{
+    KernelTable<T> table;
+#ifdef NN_X86_DISPATCH
+    switch (isa)
+    {
+    case ISA::AVX512:
+        table.gemv = gemvAVX512;
+        table.gemm = gemmAVX512<T>;
+        table.conv = convAVX512<T>;
+        break;
+    case ISA::AVX2:
+        table.gemv = gemvAVX2;
+        table.gemm = gemmAVX2<T>;
+        table.conv = convAVX2<T>;
+        break;
+    case ISA::SSE42:
+        table.gemv = gemvSSE42;
+        table.gemm = gemmSSE42<T>;
+        table.conv = convSSE42<T>;
+        break;
+    default:
+        isa = ISA::SCALAR;
+        break;
+    }
+#else
+    isa = ISA::SCALAR;
+#endif
+    table.isa = isa;
+    return table;
+}
+
+template<typename T>
+KernelTable<T>& kernelTable()
+{
+    static KernelTable<T> table = makeKernelTable<T>(detectISA());
+    return table;
+}
+
+/* Fuerza un conjunto de instrucciones (p.ej. ISA::SCALAR para comparar con la
+   referencia). No debe llamarse mientras otra hebra esté calculando. */
+inline void setISA(ISA isa)
+{
+    kernelTable<float>() = makeKernelTable<float>(isa);
+    kernelTable<double>() = makeKernelTable<double>(isa);
+}
+inline ISA activeISA() {return kernelTable<float>().isa;}
+
+// Elige las funciones una sola vez. Lo llama Net::init().
+inline void initKernels()
+{
+    static std::once_flag flag;
+    std::call_once(flag, []{
+        kernelTable<float>();
+        kernelTable<double>();
+    });
+}
+
+// out = max(in, 0). Admite in == out.
+template<typename T>
+inline void relu(const T* in, T* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = in[i] > 0? in[i] : 0;
+}
+
+/* out = (in-M)/S sobre len elementos. Devuelve false si alguna S es cero
+   (ese elemento no se escribe). Admite in == out. */
+template<typename T>
+inline bool normalize(const T* in, T* out, const T* M, const T* S, size_t len)
+{
+    bool ok = true;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (S[i] == 0)
+        {
+            ok = false;
+            continue;
+        }
+        out[i] = (in[i]-M[i])/S[i];
+    }
+    return ok;
+}
+
+// y = W*x + B, con W[rows][cols] por filas.
+template<typename T>
+void gemv(const T* W, const T* B, const T* x, T* y, size_t rows, size_t cols, Epilogue ep = Epilogue::NONE)
+{
+    kernelTable<T>().gemv(W, B, x, y, rows, cols, ep);
+}
+
+// Y[n][rows] = X[n][cols] * W^T + B, con W empaquetada por packWeights.
+template<typename T>
+void gemm(const T* Wp, const T* B, const T* X, T* Y, size_t n, size_t rows, size_t cols, Epilogue ep = Epilogue::NONE)
+{
+    kernelTable<T>().gemm(Wp, B, X, Y, n, rows, cols, rows, ep);
+}
+
+// Convolución directa del interior [i0, i1) x [j0, j1), ver convImpl.
+template<typename T>
+void conv(const T* in, T* out, size_t ld, const T* k, size_t kh, size_t kw, size_t i0, size_t i1, size_t j0, size_t j1, size_t oy = 0)
+{
+    if (i0 < i1 && j0 < j1)
+        kernelTable<T>().conv(in, out, ld, k, kh, kw, i0, i1, j0, j1, oy);
+}
+
+/* Solo los paneles de salida [p0, p1) de la misma GEMM: filas p0*NR.. de W.
+   Permite repartir las salidas entre hilos sin reempaquetar los pesos. */
+template<typename T>
+void gemmPanels(const T* Wp, const T* B, const T* X, T* Y, size_t n, size_t rows, size_t cols, size_t p0, size_t p1, Epilogue ep = Epilogue::NONE)
+{
+    constexpr size_t NR = GemmBlock<T>::NR;
+    const size_t o0 = p0*NR, o1 = std::min(rows, p1*NR);
+    if (o0 >= o1)
+        return;
+    kernelTable<T>().gemm(Wp + p0*cols*NR, B + o0, X, Y + o0, n, o1-o0, cols, rows, ep);
+}
+
+}
+}
+
+#endif
@@ -5,10 +5,21 @@
 #include <functional>
 #include <cstdio>
 #include "NNUtils.hpp"
+#include "NNKernels.hpp"
+#include "NNQuant.hpp"
+#include "NNHalf.hpp"
+#include "NNConv.hpp"
+#include "NNFFT.hpp"
+#include "NNMath.hpp"
+#include "NNThreads.hpp"
+#include "NNProfile.hpp"
 #include <math.h>
 #include <type_traits>
 #include <vector>
+#include <string>
 #include <iostream>
+#include <algorithm>
+#include <exception>
 
 namespace NN{
 
@@ -27,12 +38,14 @@ class GenericLayer
         std::shared_ptr<T> _in;
         uint16_t _size_i, _size_o;
         OPCODE _code;
+        bool _fused = false; // Absorbida por la capa anterior en Net::init()
+        std::shared_ptr<ThreadPool> _pool; // Paralelismo dentro de la capa (WG y Conv)
     public:
         GenericLayer() = delete;
         GenericLayer(const uint16_t &input_len, const uint16_t &output_len) : _size_i(input_len), _size_o(output_len)
         {
-            _in = std::shared_ptr<T>{new T[input_len]};
-            _out = std::shared_ptr<T>{new T[output_len]};
+            _in = std::shared_ptr<T>{new T[input_len], std::default_delete<T[]>()};
+            _out = std::shared_ptr<T>{new T[output_len], std::default_delete<T[]>()};
             if(input_len > 0 && output_len > 0)
                 _code = OPCODE::OK;
             else
@@ -40,7 +53,7 @@ class GenericLayer
         };
         GenericLayer(const uint16_t &input_len, const std::shared_ptr<T> &input_block, const uint16_t &output_len) : _size_i(input_len), _size_o(output_len), _in(input_block)
         {
-            _out = std::shared_ptr<T>{new T[output_len]};
+            _out = std::shared_ptr<T>{new T[output_len], std::default_delete<T[]>()};
             if(input_len > 0 && output_len > 0)
                 _code = OPCODE::OK;
             else
@@ -49,7 +62,7 @@ class GenericLayer
         GenericLayer(const uint16_t &input_len, const std::shared_ptr<T> &input_block) : GenericLayer(input_len, input_block, input_len) {};
         GenericLayer(const GenericLayer<T> * prev_layer, const uint16_t output_len) : _size_i(prev_layer->_size_o), _size_o(output_len), _in(prev_layer->_out)
         {
-            _out = std::shared_ptr<T>{new T[output_len]};
+            _out = std::shared_ptr<T>{new T[output_len], std::default_delete<T[]>()};
             if(prev_layer->code() != OPCODE::OK)
                 _code = OPCODE::BUILD_ERROR_0;
             else if(output_len == 0)
@@ -57,10 +70,21 @@ class GenericLayer
             else 
                 _code = OPCODE::OK;
         };
+        // Copia profunda: la copia tiene sus propios bloques de entrada y salida
+        GenericLayer(const GenericLayer<T> &layer) : _size_i(layer._size_i), _size_o(layer._size_o), _code(layer._code), _fused(layer._fused), _pool(layer._pool)
+        {
+            _in = std::shared_ptr<T>{new T[_size_i], std::default_delete<T[]>()};
+            _out = std::shared_ptr<T>{new T[_size_o], std::default_delete<T[]>()};
+        }
         ~GenericLayer() = default;
 
         virtual void compute() {};
+        /* Procesa n muestras contiguas: in[n][_size_i] -> out[n][_size_o]. No usa _in/_out. */
+        virtual OPCODE computeBatch(const T*, T*, size_t) const {return OPCODE::OK;}
+        // La capa admite in == out (capas elemento a elemento).
+        virtual bool inplace() const {return false;}
         virtual const char* id() const {return _id;}
+        virtual std::shared_ptr<GenericLayer<T>> clone() const {return std::make_shared<GenericLayer<T>>(*this);}
 
         T* getInputBlock() const {return _in.get();}
         T* getOutputBlock() const {return _out.get();}
@@ -71,6 +95,8 @@ class GenericLayer
         
         OPCODE code() const {return _code;}
         void clear() {_code = OPCODE::OK;}
+        bool fused() const {return _fused;}
+        void setThreadPool(std::shared_ptr<ThreadPool> pool) {_pool = std::move(pool);}
 };
 
 template<typename T = float>
@@ -94,17 +120,21 @@ class LambdaLayer : public GenericLayer<T>
                 this->_code = OPCODE::OP_ERROR_0;
                 return;
             }
-            if(_app)
-            {
-                _app(this->_in.get(), this->_out.get(), this->_size_i, this->_size_o);
-                this->_code = OPCODE::OK;
-            }
-            else
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            if(!_app)
+                return OPCODE::OP_ERROR_1;
+            for (size_t k = 0; k < n; k++)
             {
-                this->_code = OPCODE::OP_ERROR_1;
+                // La función de usuario recibe T* por compatibilidad, no debe modificar la entrada.
+                _app(const_cast<T*>(in+k*this->_size_i), out+k*this->_size_o, this->_size_i, this->_size_o);
             }
+            return OPCODE::OK;
         }
         const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<LambdaLayer<T>>(*this);}
 };
 
 template<typename T = float>
@@ -113,23 +143,98 @@ class WGLayer final : public GenericLayer<T>
     private:
         friend class Net<T>;
         static const char _id[];
-        std::unique_ptr<T> _W;
-        std::unique_ptr<T> _B;
+        std::shared_ptr<T> _W;
+        std::shared_ptr<T> _B;
+        std::shared_ptr<T> _Wp; // Pesos empaquetados para la GEMM
+        std::shared_ptr<uint16_t> _Wh; // Pesos en 16 bits (_wfmt != NATIVE)
+        bool _packed = false;
+        bool _shared_wp = false; // _Wp viene de shareWeights: pack() no escribe en él
+        WeightFormat _wfmt = WeightFormat::NATIVE;
+        Epilogue _ep = Epilogue::NONE;  // Activación fusionada
+        ActMode _ep_mode = ActMode::FAST;
+
+        // Sigmoide y softmax se aplican a cada fila recién escrita, aún en L1.
+        OPCODE finish(T* y, size_t n) const
+        {
+            const size_t so = this->_size_o;
+            for(size_t k = 0; k < n; ++k)
+            {
+                if(_ep == Epilogue::SIGMOID)
+                    kernels::sigmoid(y+k*so, y+k*so, so, _ep_mode);
+                else if(_ep == Epilogue::SOFTMAX && !kernels::softmax(y+k*so, y+k*so, so, _ep_mode))
+                    return OPCODE::OP_ERROR_2;
+            }
+            return OPCODE::OK;
+        }
+        /* Pesos en 16 bits. Por muestra la GEMV los convierte en registro; en
+           lote se convierte un bloque de filas a T y se reutiliza en todas las
+           muestras mientras sigue en caché. */
+        OPCODE computeHalf(const T* in, T* out, size_t n, ThreadPool* pool) const
+        {
+            const size_t si = this->_size_i, so = this->_size_o;
+            const uint16_t* Wh = _Wh.get();
+            if(n >= NN_GEMM_MIN_BATCH)
+            {
+                const size_t tile = std::max<size_t>(4, NN_HALF_TILE_BYTES/(si*sizeof(T))/4*4);
+                auto rows = [&](size_t r0, size_t r1){
+                    thread_local std::vector<T> wt;
+                    if(wt.size() < tile*si)
+                        wt.resize(tile*si);
+                    for(size_t t0 = r0; t0 < r1; t0 += tile)
+                    {
+                        const size_t t1 = std::min(r1, t0+tile);
+                        kernels::halfToFloat(Wh+t0*si, _wfmt, wt.data(), (t1-t0)*si);
+                        for(size_t k = 0; k < n; ++k)
+                            kernels::gemv(wt.data(), this->_B.get()+t0, in+k*si, out+k*so+t0, t1-t0, si, _ep);
+                    }
+                };
+                if(pool)
+                    pool->parallel_for(so, pool->grainFor(so, 4), rows);
+                else
+                    rows(0, so);
+                return finish(out, n);
+            }
+            for(size_t k = 0; k < n; ++k)
+            {
+                if(pool)
+                {
+                    pool->parallel_for(so, pool->grainFor(so, 4), [&](size_t r0, size_t r1){
+                        kernels::gemvHalf(Wh+r0*si, _wfmt, this->_B.get()+r0, in+k*si, out+k*so+r0, r1-r0, si, _ep);
+                    });
+                }
+                else
+                    kernels::gemvHalf(Wh, _wfmt, this->_B.get(), in+k*si, out+k*so, so, si, _ep);
+                OPCODE code = finish(out+k*so, 1);
+                if(code != OPCODE::OK)
+                    return code;
+            }
+            return OPCODE::OK;
+        }
     public:
         WGLayer() = delete;
         WGLayer(const uint16_t &input_len, const uint16_t &output_len) : GenericLayer<T>(input_len, output_len){
-            this->_B = std::unique_ptr<T>{new T[this->_size_o]};
-            this->_W = std::unique_ptr<T>{new T[this->_size_i*this->_size_o]};
+            this->_B = std::shared_ptr<T>{new T[this->_size_o], std::default_delete<T[]>()};
+            this->_W = std::shared_ptr<T>{new T[this->_size_i*this->_size_o], std::default_delete<T[]>()};
         }
         WGLayer(const uint16_t &input_len, const std::shared_ptr<T> &input_block, const uint16_t &output_len) : GenericLayer<T>(input_len, input_block, output_len){
-            this->_B = std::unique_ptr<T>{new T[this->_size_o]};
-            this->_W = std::unique_ptr<T>{new T[this->_size_i*this->_size_o]};
+            this->_B = std::shared_ptr<T>{new T[this->_size_o], std::default_delete<T[]>()};
+            this->_W = std::shared_ptr<T>{new T[this->_size_i*this->_size_o], std::default_delete<T[]>()};
         };
         WGLayer(const uint16_t &layer_len, const std::shared_ptr<T> &input_block) :  WGLayer<T>(layer_len, input_block, layer_len) {};
         WGLayer(const GenericLayer<T> * prev_layer, const uint16_t output_len) : GenericLayer<T>(prev_layer, output_len) {
-            this->_B = std::unique_ptr<T>{new T[this->_size_o]};
-            this->_W = std::unique_ptr<T>{new T[this->_size_i*this->_size_o]};
+            this->_B = std::shared_ptr<T>{new T[this->_size_o], std::default_delete<T[]>()};
+            this->_W = std::shared_ptr<T>{new T[this->_size_i*this->_size_o], std::default_delete<T[]>()};
         };
+        WGLayer(const WGLayer<T> &layer) : GenericLayer<T>(layer), _wfmt(layer._wfmt), _ep(layer._ep), _ep_mode(layer._ep_mode)
+        {
+            const size_t len = this->_size_i*this->_size_o;
+            this->_B = std::shared_ptr<T>{new T[this->_size_o], std::default_delete<T[]>()};
+            this->_W = std::shared_ptr<T>{new T[len], std::default_delete<T[]>()};
+            std::copy(layer._B.get(), layer._B.get()+this->_size_o, this->_B.get());
+            std::copy(layer._W.get(), layer._W.get()+len, this->_W.get());
+            if(layer._packed)
+                pack();
+        }
         void compute() override
         {
             if(this->_code != OPCODE::OK)
@@ -137,82 +242,288 @@ class WGLayer final : public GenericLayer<T>
                 this->_code = OPCODE::OP_ERROR_0;
                 return;
             }
-            for(uint_fast16_t i = 0; i<this->_size_o; ++i)
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            const size_t si = this->_size_i, so = this->_size_o;
+            // Con pool y trabajo suficiente cada hilo calcula un grupo de filas de salida
+            ThreadPool* pool = (this->_pool && n*si*so >= NN_PARALLEL_MIN_WORK) ? this->_pool.get() : nullptr;
+            if(_packed && _wfmt != WeightFormat::NATIVE)
+                return computeHalf(in, out, n, pool);
+            if(_packed && n >= NN_GEMM_MIN_BATCH)
             {
-                this->_out.get()[i] = this->_B.get()[i];
-                for(uint_fast16_t j = 0; j < (this->_size_i); ++j)
+                if(pool)
                 {
-                    this->_out.get()[i] += this->_W.get()[i*this->_size_i+j]*this->_in.get()[j];
+                    constexpr size_t NR = kernels::GemmBlock<T>::NR;
+                    const size_t panels = (so+NR-1)/NR;
+                    pool->parallel_for(panels, pool->grainFor(panels), [&](size_t p0, size_t p1){
+                        kernels::gemmPanels(_Wp.get(), this->_B.get(), in, out, n, so, si, p0, p1, _ep);
+                    });
                 }
+                else
+                    kernels::gemm(_Wp.get(), this->_B.get(), in, out, n, so, si, _ep);
+                return finish(out, n);
             }
+            for(size_t k = 0; k < n; ++k)
+            {
+                if(pool)
+                {
+                    pool->parallel_for(so, pool->grainFor(so, 4), [&](size_t r0, size_t r1){
+                        kernels::gemv(this->_W.get()+r0*si, this->_B.get()+r0, in+k*si, out+k*so+r0, r1-r0, si, _ep);
+                    });
+                }
+                else
+                    kernels::gemv(this->_W.get(), this->_B.get(), in+k*si, out+k*so, so, si, _ep);
+                OPCODE code = finish(out+k*so, 1);
+                if(code != OPCODE::OK)
+                    return code;
+            }
+            return OPCODE::OK;
         }
+        // Activación aplicada en el epílogo (la fija Net::init() al fusionar)
+        void setEpilogue(Epilogue ep, ActMode mode = ActMode::FAST) {_ep = ep; _ep_mode = mode;}
+        Epilogue getEpilogue() const {return _ep;}
+        /* Reempaqueta los pesos (o los convierte a 16 bits). Necesario tras
+           modificarlos con getMutWeights(). */
+        void pack()
+        {
+            if(_wfmt != WeightFormat::NATIVE)
+            {
+                const size_t n = size_t(this->_size_i)*this->_size_o;
+                _Wh = std::shared_ptr<uint16_t>{new uint16_t[n], std::default_delete<uint16_t[]>()};
+                kernels::toHalf(this->_W.get(), _Wh.get(), n, _wfmt);
+                _Wp.reset();
+                _packed = true;
+                return;
+            }
+            const size_t len = kernels::packedSize<T>(this->_size_o, this->_size_i);
+            if(!_Wp || _shared_wp)
+            {
+                _Wp = std::shared_ptr<T>{new T[len], std::default_delete<T[]>()};
+                _shared_wp = false;
+            }
+            kernels::packWeights(this->_W.get(), this->_size_o, this->_size_i, _Wp.get());
+            _packed = true;
+        }
+        bool packed() const {return _packed;}
+        /* Usa bloques externos sin copiarlos (p. ej. un fichero mapeado, ver NNFormat.hpp).
+           Wp, si se da, debe tener el formato de kernels::packWeights para este T. */
+        void shareWeights(std::shared_ptr<T> W, std::shared_ptr<T> B, std::shared_ptr<T> Wp = nullptr)
+        {
+            this->_W = std::move(W);
+            this->_B = std::move(B);
+            _Wp = std::move(Wp);
+            _packed = static_cast<bool>(_Wp);
+            _shared_wp = _packed;
+        }
+        /* Pesos guardados en fp16/bf16 y convertidos a T al calcular. _W se
+           conserva en T para editarlos, plegarlos y serializarlos. */
+        void setWeightFormat(WeightFormat fmt)
+        {
+            _wfmt = fmt;
+            if(fmt == WeightFormat::NATIVE)
+                _Wh.reset();
+            pack();
+        }
+        WeightFormat getWeightFormat() const {return _wfmt;}
+        const uint16_t* getHalfWeights() const {return (_packed && _wfmt != WeightFormat::NATIVE) ? _Wh.get() : nullptr;}
+        const T* getPackedWeights() const {return (_packed && _wfmt == WeightFormat::NATIVE) ? _Wp.get() : nullptr;}
         T* getWeights() const {return this->_W.get();}
-        T* getMutWeights() {return this->_W.get();}
+        T* getMutWeights() {_packed = false; return this->_W.get();}
         T* getBias() const {return this->_B.get();}
         T* getMutBias() {return this->_B.get();}
         uint16_t getWCols() const {return this->_size_i;}
         uint16_t getWRows() const {return this->_size_o;}
         void loadWeights(FILE* fptr)
         {
-            int ret = parseCSV(fptr, this->_W.get(), this->_size_i*this->_size_o);
-            switch (ret)
-            {
-            case -1:
-                this->_code = OPCODE::PARS_ERROR_0;
-                break;
-            case -2:
-                this->_code = OPCODE::PARS_ERROR_1;
-                break;
-            case -3:
-                this->_code = OPCODE::PARS_ERROR_2;
-                break;
-            case -4:
-                this->_code = OPCODE::PARS_ERROR_3;
-                break;
-            case 0:
-                break;
-            default:
-                #ifndef NN_NO_WARNINGS
-                this->_code = OPCODE::WARN_0;
-                #endif
-                break;
-            }
+            OPCODE ret = parseStatus(parseCSV(fptr, this->_W.get(), this->_size_i*this->_size_o));
+            if(ret != OPCODE::OK)
+                this->_code = ret;
+            pack();
         }
         void loadBias(FILE* fptr)
         {
-            int ret = parseCSV(fptr, this->_B.get(), this->_size_o);
-            switch (ret)
-            {
-            case -1:
-                this->_code = OPCODE::PARS_ERROR_0;
-                break;
-            case -2:
-                this->_code = OPCODE::PARS_ERROR_1;
-                break;
-            case -3:
-                this->_code = OPCODE::PARS_ERROR_2;
-                break;
-            case -4:
-                this->_code = OPCODE::PARS_ERROR_3;
-                break;
-            case 0:
-                break;
-            default:
-                #ifndef NN_NO_WARNINGS
-                this->_code = OPCODE::WARN_0;
-                #endif
-                break;
+            OPCODE ret = parseStatus(parseCSV(fptr, this->_B.get(), this->_size_o));
+            if(ret != OPCODE::OK)
+                this->_code = ret;
+        }
+        void loadWeights(const char* filename)
+        {
+            FILE* f = fopen(filename, "r");
+            loadWeights(f);
+            if(f)
+                fclose(f);
+        }
+        void loadBias(const char* filename)
+        {
+            FILE* f = fopen(filename, "r");
+            loadBias(f);
+            if(f)
+                fclose(f);
+        }
+        const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<WGLayer<T>>(*this);}
+};
+
+/* WG con pesos int8 (escala y punto cero por fila de salida) y acumulación
+   en int32. La entrada se cuantiza en cada pasada; ver NNQuant.hpp. */
+template<typename T = float>
+class QuantWGLayer final : public GenericLayer<T>
+{
+    private:
+        friend class Net<T>;
+        static const char _id[];
+        size_t _stride;                 // Columnas de _Wq, múltiplo de 64
+        std::shared_ptr<int8_t> _Wq;    // Inmutable: quantize() crea un bloque nuevo
+        std::shared_ptr<T> _scale;
+        std::shared_ptr<int32_t> _zero, _rowsum;
+        std::shared_ptr<T> _B;
+
+        // Entrada cuantizada y acumuladores de la hebra que calcula
+        struct Scratch
+        {
+            std::shared_ptr<uint8_t> xq;
+            std::vector<int32_t> acc;
+            size_t len = 0;
+        };
+        static Scratch& scratch(size_t stride, size_t rows)
+        {
+            thread_local Scratch s;
+            if(s.len < stride)
+            {
+                s.xq = alignedBlock<uint8_t>(stride);
+                s.len = stride;
             }
+            if(s.acc.size() < rows)
+                s.acc.resize(rows);
+            return s;
+        }
+        void allocate()
+        {
+            _stride = kernels::qStride(this->_size_i);
+            _Wq = alignedBlock<int8_t>(this->_size_o*_stride);
+            std::fill(_Wq.get(), _Wq.get()+this->_size_o*_stride, int8_t(0));
+            _scale = std::shared_ptr<T>{new T[this->_size_o](), std::default_delete<T[]>()};
+            _zero = std::shared_ptr<int32_t>{new int32_t[this->_size_o](), std::default_delete<int32_t[]>()};
+            _rowsum = std::shared_ptr<int32_t>{new int32_t[this->_size_o](), std::default_delete<int32_t[]>()};
+            _B = std::shared_ptr<T>{new T[this->_size_o](), std::default_delete<T[]>()};
+        }
+    public:
+        QuantWGLayer() = delete;
+        QuantWGLayer(const uint16_t &input_len, const uint16_t &output_len) : GenericLayer<T>(input_len, output_len) {allocate();}
+        QuantWGLayer(const uint16_t &input_len, const std::shared_ptr<T> &input_block, const uint16_t &output_len) : GenericLayer<T>(input_len, input_block, output_len) {allocate();}
+        QuantWGLayer(const GenericLayer<T> * prev_layer, const uint16_t output_len) : GenericLayer<T>(prev_layer, output_len) {allocate();}
+        // Los pesos cuantizados se comparten (son inmutables), el sesgo se copia
+        QuantWGLayer(const QuantWGLayer<T> &layer) : GenericLayer<T>(layer), _stride(layer._stride), _Wq(layer._Wq),
+            _scale(layer._scale), _zero(layer._zero), _rowsum(layer._rowsum)
+        {
+            _B = std::shared_ptr<T>{new T[this->_size_o], std::default_delete<T[]>()};
+            std::copy(layer._B.get(), layer._B.get()+this->_size_o, _B.get());
+        }
+        void compute() override
+        {
+            if(this->_code != OPCODE::OK)
+            {
+                this->_code = OPCODE::OP_ERROR_0;
+                return;
+            }
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            const size_t si = this->_size_i, so = this->_size_o;
+            ThreadPool* pool = (this->_pool && si*so >= NN_PARALLEL_MIN_WORK) ? this->_pool.get() : nullptr;
+            Scratch &s = scratch(_stride, so);
+            const int8_t* Wq = _Wq.get();
+            const kernels::QGemvFn qgemv = kernels::qgemvKernel();
+            for(size_t k = 0; k < n; ++k)
+            {
+                T sx;
+                int32_t zx;
+                const int64_t sumx = kernels::quantizeInput(in+k*si, si, s.xq.get(), sx, zx);
+                const uint8_t* xq = s.xq.get();
+                int32_t* acc = s.acc.data();
+                if(pool)
+                {
+                    pool->parallel_for(so, pool->grainFor(so, 4), [&](size_t r0, size_t r1){
+                        qgemv(Wq+r0*_stride, xq, acc+r0, r1-r0, _stride);
+                    });
+                }
+                else
+                    qgemv(Wq, xq, acc, so, _stride);
+                // Descuantización
+                T* y = out+k*so;
+                const int64_t czx = int64_t(si)*zx;
+                for(size_t i = 0; i < so; ++i)
+                {
+                    const int64_t zw = _zero.get()[i];
+                    const int64_t a = acc[i] - zx*int64_t(_rowsum.get()[i]) - zw*sumx + zw*czx;
+                    y[i] = _scale.get()[i]*sx*T(a) + _B.get()[i];
+                }
+            }
+            return OPCODE::OK;
+        }
+        // Cuantiza W[outputs][inputs] por filas
+        void quantize(const T* W)
+        {
+            auto Wq = alignedBlock<int8_t>(this->_size_o*_stride);
+            auto scale = std::shared_ptr<T>{new T[this->_size_o], std::default_delete<T[]>()};
+            auto zero = std::shared_ptr<int32_t>{new int32_t[this->_size_o], std::default_delete<int32_t[]>()};
+            auto rowsum = std::shared_ptr<int32_t>{new int32_t[this->_size_o], std::default_delete<int32_t[]>()};
+            kernels::quantizeRows(W, this->_size_o, this->_size_i, Wq.get(), scale.get(), zero.get(), rowsum.get());
+            _Wq = std::move(Wq);
+            _scale = std::move(scale);
+            _zero = std::move(zero);
+            _rowsum = std::move(rowsum);
+        }
+        // Pesos aproximados s_i*(Wq - zw_i), en W[outputs][inputs]
+        void dequantize(T* W) const
+        {
+            for(size_t i = 0; i < this->_size_o; ++i)
+                for(size_t j = 0; j < this->_size_i; ++j)
+                    W[i*this->_size_i+j] = _scale.get()[i]*T(int32_t(_Wq.get()[i*_stride+j]) - _zero.get()[i]);
+        }
+        const int8_t* getQuantWeights() const {return _Wq.get();}
+        size_t getQuantStride() const {return _stride;}
+        const T* getScales() const {return _scale.get();}
+        const int32_t* getZeroPoints() const {return _zero.get();}
+        T* getBias() const {return _B.get();}
+        T* getMutBias() {return _B.get();}
+        uint16_t getWCols() const {return this->_size_i;}
+        uint16_t getWRows() const {return this->_size_o;}
+        // Lee los pesos en T y los cuantiza
+        void loadWeights(FILE* fptr)
+        {
+            std::vector<T> W(size_t(this->_size_i)*this->_size_o);
+            OPCODE ret = parseStatus(parseCSV(fptr, W.data(), W.size()));
+            if(ret != OPCODE::OK)
+                this->_code = ret;
+            else
+                quantize(W.data());
+        }
+        void loadBias(FILE* fptr)
+        {
+            OPCODE ret = parseStatus(parseCSV(fptr, _B.get(), this->_size_o));
+            if(ret != OPCODE::OK)
+                this->_code = ret;
         }
         void loadWeights(const char* filename)
         {
-            loadWeights(fopen(filename, "r"));
+            FILE* f = fopen(filename, "r");
+            loadWeights(f);
+            if(f)
+                fclose(f);
         }
         void loadBias(const char* filename)
         {
-            loadBias(fopen(filename, "r"));
+            FILE* f = fopen(filename, "r");
+            loadBias(f);
+            if(f)
+                fclose(f);
         }
         const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<QuantWGLayer<T>>(*this);}
 };
 
 template<typename T = float>
@@ -234,12 +545,16 @@ class ReLuLayer final : public GenericLayer<T>
                 this->_code = OPCODE::OP_ERROR_0;
                 return;
             }
-            for (size_t i = 0; i < this->_size_i; i++)
-            {
-                this->_out.get()[i] = this->_in.get()[i] > 0? this->_in.get()[i] : 0;
-            }
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            kernels::relu(in, out, n*this->_size_i);
+            return OPCODE::OK;
         }
+        bool inplace() const override {return true;}
         const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<ReLuLayer<T>>(*this);}
 };
 
 template<typename T = float>
@@ -248,22 +563,30 @@ class NormLayer final : public GenericLayer<T>
     private:
         friend class Net<T>;
         static const char _id[];
-        std::unique_ptr<T> _M;
-        std::unique_ptr<T> _S;
+        std::shared_ptr<T> _M;
+        std::shared_ptr<T> _S;
     public:
         NormLayer() = delete;
         NormLayer(const uint16_t &layer_len) : GenericLayer<T>(layer_len, layer_len){
-            this->_M = std::unique_ptr<T>{new T[layer_len]};
-            this->_S = std::unique_ptr<T>{new T[layer_len]};
+            this->_M = std::shared_ptr<T>{new T[layer_len], std::default_delete<T[]>()};
+            this->_S = std::shared_ptr<T>{new T[layer_len], std::default_delete<T[]>()};
         };
         NormLayer(const uint16_t &layer_len, const std::shared_ptr<T> &input_block) : GenericLayer<T>(layer_len, input_block, layer_len){
-            this->_M = std::unique_ptr<T>{new T[layer_len]};
-            this->_S = std::unique_ptr<T>{new T[layer_len]};
+            this->_M = std::shared_ptr<T>{new T[layer_len], std::default_delete<T[]>()};
+            this->_S = std::shared_ptr<T>{new T[layer_len], std::default_delete<T[]>()};
         };
         NormLayer(const GenericLayer<T> * prev_layer) : GenericLayer<T>(prev_layer, prev_layer->getOutputSize()) {
-            this->_M = std::unique_ptr<T>{new T[this->_size_o]};
-            this->_S = std::unique_ptr<T>{new T[this->_size_i*this->_size_o]};
+            this->_M = std::shared_ptr<T>{new T[this->_size_o], std::default_delete<T[]>()};
+            this->_S = std::shared_ptr<T>{new T[this->_size_i*this->_size_o], std::default_delete<T[]>()};
         };
+        NormLayer(const NormLayer<T> &layer) : GenericLayer<T>(layer)
+        {
+            const size_t len = this->_size_i;
+            this->_M = std::shared_ptr<T>{new T[len], std::default_delete<T[]>()};
+            this->_S = std::shared_ptr<T>{new T[len], std::default_delete<T[]>()};
+            std::copy(layer._M.get(), layer._M.get()+len, this->_M.get());
+            std::copy(layer._S.get(), layer._S.get()+len, this->_S.get());
+        }
         void compute() override
         {
             if(this->_code != OPCODE::OK)
@@ -271,82 +594,59 @@ class NormLayer final : public GenericLayer<T>
                 this->_code = OPCODE::OP_ERROR_0;
                 return;
             }
-            for (size_t i = 0; i < this->_size_i; i++)
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            OPCODE ret = OPCODE::OK;
+            const size_t len = this->_size_i;
+            for (size_t k = 0; k < n; k++)
             {
-                if (this->_S.get()[i] == 0)
-                {
-                    this->_code = OPCODE::OP_ERROR_2;
-                    continue;
-                }
-                this->_out.get()[i] = (this->_in.get()[i]-this->_M.get()[i])/this->_S.get()[i];
+                if (!kernels::normalize(in + k*len, out + k*len, this->_M.get(), this->_S.get(), len))
+                    ret = OPCODE::OP_ERROR_2;
             }
+            return ret;
         }
         T* getMeans() const {return this->_M.get();}
         T* getMutMeans() {return this->_M.get();}
         T* getSD() const {return this->_S.get();}
         T* getMutSD() {return this->_S.get();}
+        // Usa bloques externos sin copiarlos (ver WGLayer::shareWeights)
+        void shareStats(std::shared_ptr<T> M, std::shared_ptr<T> S)
+        {
+            this->_M = std::move(M);
+            this->_S = std::move(S);
+        }
         uint16_t getLayerLen() const {return this->_size_i;}
         void loadMeans(FILE* fptr)
         {
-            int ret = parseCSV(fptr, this->_M.get(), this->_size_i);
-            switch (ret)
-            {
-            case -1:
-                this->_code = OPCODE::PARS_ERROR_0;
-                break;
-            case -2:
-                this->_code = OPCODE::PARS_ERROR_1;
-                break;
-            case -3:
-                this->_code = OPCODE::PARS_ERROR_2;
-                break;
-            case -4:
-                this->_code = OPCODE::PARS_ERROR_3;
-                break;
-            case 0:
-                break;
-            default:
-                #ifndef NN_NO_WARNINGS
-                this->_code = OPCODE::WARN_0;
-                #endif
-                break;
-            }
+            OPCODE ret = parseStatus(parseCSV(fptr, this->_M.get(), this->_size_i));
+            if(ret != OPCODE::OK)
+                this->_code = ret;
         }
         void loadSD(FILE* fptr)
         {
-            int ret = parseCSV(fptr, this->_S.get(), this->_size_o);
-            switch (ret)
-            {
-            case -1:
-                this->_code = OPCODE::PARS_ERROR_0;
-                break;
-            case -2:
-                this->_code = OPCODE::PARS_ERROR_1;
-                break;
-            case -3:
-                this->_code = OPCODE::PARS_ERROR_2;
-                break;
-            case -4:
-                this->_code = OPCODE::PARS_ERROR_3;
-                break;
-            case 0:
-                break;
-            default:
-                #ifndef NN_NO_WARNINGS
-                this->_code = OPCODE::WARN_0;
-                #endif
-                break;
-            }
+            OPCODE ret = parseStatus(parseCSV(fptr, this->_S.get(), this->_size_o));
+            if(ret != OPCODE::OK)
+                this->_code = ret;
         }
         void loadMeans(const char* filename)
         {
-            loadMeans(fopen(filename, "r"));
+            FILE* f = fopen(filename, "r");
+            loadMeans(f);
+            if(f)
+                fclose(f);
         }
         void loadSD(const char* filename)
         {
-            loadSD(fopen(filename, "r"));
+            FILE* f = fopen(filename, "r");
+            loadSD(f);
+            if(f)
+                fclose(f);
         }
+        bool inplace() const override {return true;}
         const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<NormLayer<T>>(*this);}
 };
 
 template<typename T = float>
@@ -355,6 +655,7 @@ class SoftMaxLayer final : public GenericLayer<T>
     private:
         friend class Net<T>;
         static const char _id[];
+        ActMode _mode = ActMode::FAST;
     public:
         SoftMaxLayer() = delete;
         SoftMaxLayer(const uint16_t &layer_len) : GenericLayer<T>(layer_len, layer_len){};
@@ -369,23 +670,23 @@ class SoftMaxLayer final : public GenericLayer<T>
                 this->_code = OPCODE::OP_ERROR_0;
                 return;
             }
-            T eacc = 0;
-            for (size_t i = 0; i < this->_size_i; i++)
-            {
-                this->_out.get()[i] = exp(this->_in.get()[i]);
-                eacc += this->_out.get()[i];
-            }
-            if (eacc == 0)
-            {
-                this->_code = OPCODE::OP_ERROR_2;
-                return;
-            }
-            for (size_t i = 0; i < this->_size_i; i++)
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            const size_t len = this->_size_i;
+            for (size_t k = 0; k < n; k++)
             {
-                this->_out.get()[i] = this->_out.get()[i]/eacc;
+                if (!kernels::softmax(in + k*len, out + k*len, len, _mode))
+                    return OPCODE::OP_ERROR_2;
             }
+            return OPCODE::OK;
         }
+        void setMode(ActMode mode) {_mode = mode;}
+        ActMode getMode() const {return _mode;}
+        bool inplace() const override {return true;}
         const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<SoftMaxLayer<T>>(*this);}
 };
 
 template<typename T = float>
@@ -397,6 +698,85 @@ class ConvLayer final : public GenericLayer<T>
         ConvKernel<T> _kernel;
         dim_t _dim;
         ConvPadding _padding = ConvPadding::VALID;
+        ConvMethod _method = ConvMethod::AUTO;   // Pedido con setMethod()
+        ConvMethod _active = ConvMethod::DIRECT; // Elegido en setKernel()
+        std::vector<T> _U; // Kernel transformado (Winograd) o factores u, v (separable)
+        kernels::FFTConv<T> _fft; // Espectro del kernel (FFT)
+        std::vector<T> _stream; // Modo flujo: kw-1 muestras de historia + bloque nuevo
+        size_t _fill = 0;
+        bool _pooling = false; // Pooling fusionado por Net::init()
+        PoolParams _pp;
+        PoolMode _pmode = PoolMode::MAX;
+
+        /* Elige el algoritmo y transforma el kernel.
+           - SEPARABLE: kernels 2D de rango 1 (ver kernels::separate).
+           - FFT: cualquier kernel, ver NNFFT.hpp.
+           - Winograd: solo kernels 3x3.
+           AUTO deja los 3x3 y 5x5 en el cálculo directo, que tiene versiones
+           desenrolladas más rápidas que las transformadas. Con el resto compara
+           el coste del directo (kh*kw productos por salida interior), del
+           separable (kh+kw) y de la FFT (NN_FFT_COST*N*log2(N) para la rejilla
+           de N puntos) y toma el menor. */
+        void plan()
+        {
+            _active = ConvMethod::DIRECT;
+            _U.clear();
+            _fft = kernels::FFTConv<T>();
+            if(this->_code != OPCODE::OK || _kernel.rows() > _dim.rows || _kernel.cols() > _dim.cols)
+                return;
+            const size_t kh = _kernel.rows(), kw = _kernel.cols();
+            std::vector<T> uv(kh+kw);
+            const bool sep = kh > 1 && kw > 1 && kernels::separate(_kernel.data, kh, kw, uv.data(), uv.data()+kh);
+            ConvMethod m = _method;
+            if(m == ConvMethod::AUTO)
+            {
+                if(kh == kw && (kh == 3 || kh == 5))
+                    return;
+                // Rejilla de FFTConv sin construirla (sus tablas no hacen falta para estimar)
+                const double n = double(kernels::nextPow2(_dim.rows))*std::max<size_t>(2, kernels::nextPow2(_dim.cols));
+                const double inner = double(_dim.rows-kh+1)*(_dim.cols-kw+1);
+                const double direct = inner*kh*kw;
+                const double separable = sep ? inner*(kh+kw) : direct;
+                const double fft = NN_FFT_COST*n*std::log2(n);
+                if(fft < std::min(direct, separable))
+                    m = ConvMethod::FFT;
+                else if(sep)
+                    m = ConvMethod::SEPARABLE;
+                else
+                    return;
+            }
+            if(m == ConvMethod::FFT)
+            {
+                _fft = kernels::FFTConv<T>(_dim.rows, _dim.cols);
+                _fft.setKernel(_kernel.data, kh, kw);
+                _active = m;
+                return;
+            }
+            if(m == ConvMethod::SEPARABLE)
+            {
+                if(sep)
+                {
+                    _U = std::move(uv);
+                    _active = m;
+                }
+                return;
+            }
+            if(m == ConvMethod::DIRECT || kh != 3 || kw != 3 || _dim.rows < 4 || _dim.cols < 4)
+                return;
+            const size_t inner = std::min(_dim.rows, _dim.cols) - 2;
+            if(m == ConvMethod::WINOGRAD_4X4 && inner >= 4)
+            {
+                _U.resize(36);
+                kernels::winogradKernel<T, kernels::WinogradF4<T>>(_kernel.data, _U.data());
+            }
+            else
+            {
+                m = ConvMethod::WINOGRAD_2X2;
+                _U.resize(16);
+                kernels::winogradKernel<T, kernels::WinogradF2<T>>(_kernel.data, _U.data());
+            }
+            _active = m;
+        }
     public:
         ConvLayer() = delete;
         ConvLayer(const dim_t &layer_dim) : _dim(layer_dim), GenericLayer<T>(layer_dim.cols*layer_dim.rows, layer_dim.cols*layer_dim.rows)
@@ -422,6 +802,7 @@ class ConvLayer final : public GenericLayer<T>
         };
 
         uint16_t getLayerLen() const {return this->_size_i;}
+        dim_t getDim() const {return _dim;}
         void setKernel(const ConvKernel<T> &kernel) 
         {
             if(this->_code == OPCODE::CONF_ERROR_0)
@@ -437,13 +818,77 @@ class ConvLayer final : public GenericLayer<T>
                 this->_code = OPCODE::CONF_ERROR_2;
             }
             this->_kernel = kernel;
+            plan();
+            resetStream();
         }
         ConvKernel<T> getKernel() const {return _kernel;}
+        /* Algoritmo de la convolución. El kernel se transforma en setKernel():
+           si se modifican sus datos hay que volver a llamarlo. */
+        void setMethod(ConvMethod method)
+        {
+            _method = method;
+            plan();
+        }
+        // Algoritmo en uso: DIRECT si el pedido no es aplicable a este kernel
+        ConvMethod method() const {return _active;}
+        bool separable() const {return _active == ConvMethod::SEPARABLE;}
         void setPadding(ConvPadding padding)
         {
             _padding = padding;
         }
 
+        /* Modo flujo para kernels 1D: añade n muestras a la señal y escribe en
+           out solo las salidas que completan, y[t] = sum k[kj]*x[t-kw+1+kj].
+           Son n salvo en las kw-1 primeras muestras del flujo. Devuelve cuántas
+           escribe (0 si el kernel no es 1D). No usa el bloque de entrada. */
+        size_t push(const T* chunk, size_t n, T* out)
+        {
+            if(this->_code != OPCODE::OK)
+            {
+                this->_code = OPCODE::OP_ERROR_0;
+                return 0;
+            }
+            if(_kernel.rows() != 1)
+                return 0;
+            const size_t kw = _kernel.cols(), h = kw-1;
+            if(_stream.empty())
+                _stream.resize(h + std::max<size_t>(NN_STREAM_BLOCK, kw));
+            size_t emitted = 0;
+            while(n > 0)
+            {
+                if(_fill == _stream.size())
+                {
+                    std::copy(_stream.end()-h, _stream.end(), _stream.begin());
+                    _fill = h;
+                }
+                const size_t m = std::min(n, _stream.size()-_fill);
+                std::copy(chunk, chunk+m, _stream.begin()+_fill);
+                const size_t first = std::max(_fill, h); // Primera ventana que termina en una muestra nueva
+                _fill += m;
+                if(_fill > first)
+                {
+                    kernels::correlate1D(_stream.data()+first-h, _kernel.data, kw, out+emitted, _fill-first);
+                    emitted += _fill-first;
+                }
+                chunk += m;
+                n -= m;
+            }
+            return emitted;
+        }
+        // Igual, escribiendo en el bloque de salida (n <= getLayerLen())
+        size_t push(const T* chunk, size_t n)
+        {
+            if(n > this->_size_o)
+                return 0;
+            return push(chunk, n, this->_out.get());
+        }
+        // Descarta la historia del flujo
+        void resetStream()
+        {
+            _stream.clear();
+            _fill = 0;
+        }
+
         void compute() override
         {
             if(this->_code != OPCODE::OK)
@@ -451,64 +896,461 @@ class ConvLayer final : public GenericLayer<T>
                 this->_code = OPCODE::OP_ERROR_0;
                 return;
             }
+            convolve(this->_in.get(), this->_out.get());
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            const size_t so = _pooling ? _pp.outputLen() : this->_size_o;
+            for (size_t k = 0; k < n; k++)
+            {
+                convolve(in+k*this->_size_i, out+k*so);
+            }
+            return OPCODE::OK;
+        }
+        // Pooling fusionado (lo asigna Net::init()): la salida pasa a ser la reducida
+        bool pooling() const {return _pooling;}
+    private:
+        void setPooling(const PoolParams &params, PoolMode mode)
+        {
+            _pooling = true;
+            _pp = params;
+            _pmode = mode;
+        }
+        void clearPooling() {_pooling = false;}
 
-            uint16_t i0 = this->_kernel.rows()/2;
-            uint16_t j0 = this->_kernel.cols()/2;
-            uint16_t iend = this->_dim.rows - i0;
-            uint16_t jend = this->_dim.cols - j0;
+        // Con pool y trabajo suficiente se reparte la imagen en bandas de filas
+        void convolve(const T* in, T* out) const
+        {
+            if (_pooling)
+            {
+                convolvePooled(in, out);
+                return;
+            }
+            if (_active == ConvMethod::FFT)
+            {
+                fftPass(in, out);
+                return;
+            }
+            const size_t work = size_t(this->_size_o)*this->_kernel.size();
+            if (this->_pool && work >= NN_PARALLEL_MIN_WORK)
+            {
+                ThreadPool* pool = this->_pool.get();
+                pool->parallel_for(this->_dim.rows, pool->grainFor(this->_dim.rows, 4), [&](size_t i_begin, size_t i_end){
+                    convolve(in, out, i_begin, i_end);
+                });
+            }
+            else
+                convolve(in, out, 0, this->_dim.rows);
+        }
+        /* Filas [i_begin, i_end). Con Winograd las teselas completas del interior
+           van por kernels::winogradRegion y el resto (bordes y filas o columnas
+           que no llenan una tesela) por el cálculo directo. Con SEPARABLE el
+           interior va por dos pasadas 1D y los bordes por el cálculo directo.
+           out empieza en la fila oy de la salida (oy <= i_begin). */
+        void convolve(const T* in, T* out, size_t i_begin, size_t i_end, size_t oy = 0) const
+        {
+            const size_t ld = this->_dim.cols;
+            if(_active == ConvMethod::DIRECT)
+            {
+                direct(in, out, i_begin, i_end, 0, ld, oy);
+                return;
+            }
+            if(_active == ConvMethod::SEPARABLE)
+            {
+                separablePass(in, out, i_begin, i_end, oy);
+                return;
+            }
+            const size_t M = _active == ConvMethod::WINOGRAD_4X4 ? 4 : 2;
+            const size_t r0 = std::max<size_t>(i_begin, 1);
+            const size_t r1 = std::max(r0, std::min<size_t>(i_end, this->_dim.rows-1));
+            const size_t tr = (r1-r0)/M, tc = (ld-2)/M;
+            if(tr == 0 || tc == 0)
+            {
+                direct(in, out, i_begin, i_end, 0, ld, oy);
+                return;
+            }
+            const size_t rt = r0 + tr*M, ct = 1 + tc*M;
+            direct(in, out, i_begin, r0, 0, ld, oy);
+            if(M == 4)
+                kernels::winogradRegion<T, kernels::WinogradF4<T>>(in, out, ld, _U.data(), r0, tr, 1, tc, oy);
+            else
+                kernels::winogradRegion<T, kernels::WinogradF2<T>>(in, out, ld, _U.data(), r0, tr, 1, tc, oy);
+            direct(in, out, r0, rt, 0, 1, oy);
+            direct(in, out, r0, rt, ct, ld, oy);
+            direct(in, out, rt, i_end, 0, ld, oy);
+        }
+        void separablePass(const T* in, T* out, size_t i_begin, size_t i_end, size_t oy) const
+        {
+            const size_t ld = this->_dim.cols;
+            const size_t kh = _kernel.rows(), kw = _kernel.cols();
+            const size_t ci = kh/2, cj = kw/2;
+            const size_t r0 = std::max(i_begin, ci), r1 = std::min<size_t>(i_end, this->_dim.rows - ci);
+            const size_t c1 = this->_dim.cols - cj;
+            if(r0 >= r1 || cj >= c1)
+            {
+                direct(in, out, i_begin, i_end, 0, ld, oy);
+                return;
+            }
+            thread_local std::vector<T> tmp;
+            if(tmp.size() < (r1-r0+kh-1)*ld)
+                tmp.resize((r1-r0+kh-1)*ld);
+            direct(in, out, i_begin, r0, 0, ld, oy);
+            kernels::separableRegion(in, out, ld, _U.data(), kh, _U.data()+kh, kw, ci, cj, r0, r1, cj, c1, tmp.data(), oy);
+            direct(in, out, r0, r1, 0, cj, oy);
+            direct(in, out, r0, r1, c1, ld, oy);
+            direct(in, out, r1, i_end, 0, ld, oy);
+        }
+        /* Convolución + pooling: las filas de la convolución se calculan por
+           bandas de unos NN_CONV_TILE_BYTES, que cubren las ventanas de varias
+           filas de salida del pooling, y se reducen en el momento. La FFT
+           trabaja con la imagen entera, así que con ella se reduce desde un
+           bloque temporal completo. */
+        void convolvePooled(const T* in, T* out) const
+        {
+            const size_t ld = this->_dim.cols;
+            const dim_t o = _pp.output();
+            const size_t ph = _pp.size.rows, pw = _pp.size.cols, sh = _pp.stride.rows, sw = _pp.stride.cols;
+            if (_active == ConvMethod::FFT)
+            {
+                thread_local std::vector<T> full;
+                if (full.size() < this->_size_o)
+                    full.resize(this->_size_o);
+                fftPass(in, full.data());
+                for (size_t r = 0; r < o.rows; r++)
+                    kernels::poolRow(full.data() + r*sh*ld, ld, out + r*o.cols, o.cols, ph, pw, sw, _pmode);
+                return;
+            }
+            const size_t per_band = std::max<size_t>(1, NN_CONV_TILE_BYTES/(sizeof(T)*ld*sh)); // Filas del pooling por banda
+            const size_t bands = (o.rows + per_band - 1)/per_band;
+            auto run = [&](size_t b_begin, size_t b_end){
+                thread_local std::vector<T> band;
+                for (size_t b = b_begin; b < b_end; b++)
+                {
+                    const size_t r0 = b*per_band, r1 = std::min<size_t>(o.rows, r0 + per_band);
+                    const size_t i0 = r0*sh, i1 = (r1-1)*sh + ph;
+                    if (band.size() < (i1-i0)*ld)
+                        band.resize((i1-i0)*ld);
+                    convolve(in, band.data(), i0, i1, i0);
+                    for (size_t r = r0; r < r1; r++)
+                        kernels::poolRow(band.data() + (r*sh-i0)*ld, ld, out + r*o.cols, o.cols, ph, pw, sw, _pmode);
+                }
+            };
+            const size_t work = size_t(this->_size_o)*this->_kernel.size();
+            if (this->_pool && work >= NN_PARALLEL_MIN_WORK)
+                this->_pool->parallel_for(bands, this->_pool->grainFor(bands), run);
+            else
+                run(0, bands);
+        }
+        // Interior por FFT (toda la imagen a la vez) y bordes por el cálculo directo
+        void fftPass(const T* in, T* out) const
+        {
+            const size_t ld = this->_dim.cols, rows = this->_dim.rows;
+            const size_t kh = _kernel.rows(), kw = _kernel.cols();
+            const size_t i0 = kh/2, j0 = kw/2, iend = rows - i0, jend = ld - j0;
+            if(i0 >= iend || j0 >= jend)
+            {
+                direct(in, out, 0, rows, 0, ld);
+                return;
+            }
+            // out[i][j] = full[i-i0+kh-1][j-j0+kw-1]
+            _fft.correlate(in, rows, ld, out, ld, kh-1, iend-i0+kh-1, kw-1, jend-j0+kw-1, i0, j0);
+            direct(in, out, 0, i0, 0, ld);
+            direct(in, out, i0, iend, 0, j0);
+            direct(in, out, i0, iend, jend, ld);
+            direct(in, out, iend, rows, 0, ld);
+        }
+        /* Convolución directa de las salidas [i_begin, i_end) x [j_begin, j_end).
+           La parte interior va sin ramas por kernels::conv y solo los bordes
+           (kh/2 filas y kw/2 columnas por lado) por border(). out empieza en la fila oy. */
+        void direct(const T* in, T* out, size_t i_begin, size_t i_end, size_t j_begin, size_t j_end, size_t oy = 0) const
+        {
+            const size_t ld = this->_dim.cols, rows = this->_dim.rows;
+            const size_t kh = this->_kernel.rows(), kw = this->_kernel.cols();
+            const size_t i0 = kh/2, j0 = kw/2;
+            const size_t iend = rows > i0 ? rows - i0 : 0, jend = ld > j0 ? ld - j0 : 0;
+            const size_t r0 = std::min(std::max(i_begin, i0), i_end), r1 = std::max(r0, std::min(i_end, iend));
+            const size_t c0 = std::min(std::max(j_begin, j0), j_end), c1 = std::max(c0, std::min(j_end, jend));
+            if(r0 == r1 || c0 == c1)
+            {
+                border(in, out, i_begin, i_end, j_begin, j_end, oy);
+                return;
+            }
+            kernels::conv(in, out, ld, this->_kernel.data, kh, kw, r0, r1, c0, c1, oy);
+            border(in, out, i_begin, r0, j_begin, j_end, oy);
+            border(in, out, r0, r1, j_begin, c0, oy);
+            border(in, out, r0, r1, c1, j_end, oy);
+            border(in, out, r1, i_end, j_begin, j_end, oy);
+        }
+        // Salidas de borde: SAME repite la entrada más cercana del interior, VALID escribe 0
+        void border(const T* in, T* out, size_t i_begin, size_t i_end, size_t j_begin, size_t j_end, size_t oy) const
+        {
+            const size_t ld = this->_dim.cols;
+            const size_t i0 = this->_kernel.rows()/2;
+            const size_t j0 = this->_kernel.cols()/2;
+            const size_t iend = this->_dim.rows - i0;
+            const size_t jend = this->_dim.cols - j0;
 
-            for (size_t i = 0; i < this->_dim.rows; i++)
+            for (size_t i = i_begin; i < i_end; i++)
             {
-                for (size_t j = 0; j < this->_dim.cols; j++)
+                T* row = out + (i-oy)*ld;
+                for (size_t j = j_begin; j < j_end; j++)
                 {
-                    if((i >= i0) && (i < iend) && (j >= j0) && (j < jend))
+                    if (this->_padding == ConvPadding::SAME) // SAME
                     {
-                        T calc = 0;
-                        for (size_t ki = 0; ki < this->_kernel.rows(); ki++)
+                        if(i >= iend) // Borde inferior
                         {
-                            for (size_t kj = 0; kj < this->_kernel.cols(); kj++)
-                            {
-                                calc += this->_in.get()[this->_dim.rows*(i-i0+ki)+(j-j0+kj)] * this->_kernel.data[this->_kernel.rows()*ki+kj];
-                            }
+                            if (i != j)
+                                row[j] = in[ld*(iend-1)+j];
+                            else
+                                row[j] = in[ld*(iend-1)+(jend-1)];
                         }
-                        this->_out.get()[this->_dim.rows*i+j] = calc;
-                    } 
-                    else // Bordes
-                    {
-                        if (this->_padding == ConvPadding::SAME) // SAME
+                        else if (i < i0) // Borde superior
                         {
-                            if(i >= iend) // Borde inferior
-                            {
-                                if (i != j)
-                                    this->_out.get()[this->_dim.rows*i+j] = this->_in.get()[this->_dim.rows*(iend-1)+j];
-                                else
-                                    this->_out.get()[this->_dim.rows*i+j] = this->_in.get()[this->_dim.rows*(iend-1)+(jend-1)];
-                            }
-                            else if (i < i0) // Borde superior
-                            {
-                                if (i != j)
-                                    this->_out.get()[this->_dim.rows*i+j] = this->_in.get()[this->_dim.rows*i0+j];
-                                else
-                                    this->_out.get()[this->_dim.rows*i+j] = this->_in.get()[this->_dim.rows*i0+j0];
-                            }
-                            else if (j >= jend) // Borde derecho
-                            {
-                                this->_out.get()[this->_dim.rows*i+j] = this->_in.get()[this->_dim.rows*i+(jend-1)];
-                            }
-                            else // Borde izquierdo
-                            {
-                                this->_out.get()[this->_dim.rows*i+j] = this->_in.get()[this->_dim.rows*i+j0];
-                            }
+                            if (i != j)
+                                row[j] = in[ld*i0+j];
+                            else
+                                row[j] = in[ld*i0+j0];
                         }
-                        else // VALID
+                        else if (j >= jend) // Borde derecho
                         {
-                            this->_out.get()[this->_dim.rows*i+j] = 0;
+                            row[j] = in[ld*i+(jend-1)];
+                        }
+                        else // Borde izquierdo
+                        {
+                            row[j] = in[ld*i+j0];
                         }
                     }
+                    else // VALID
+                    {
+                        row[j] = 0;
+                    }
                 }
             }
         }
+    public:
+        const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<ConvLayer<T>>(*this);}
+};
+
+/* Convolución 2D con varios canales de entrada y varios filtros, paso,
+   dilatación y relleno (ver Conv2DParams), en NCHW o NHWC. Se calcula como
+   im2col + GEMM (NNConv.hpp). Pesos W[filtros][canales][kh][kw] y sesgo por filtro. */
+template<typename T = float>
+class Conv2DLayer final : public GenericLayer<T>
+{
+    private:
+        friend class Net<T>;
+        static const char _id[];
+        Conv2DParams _p;
+        std::shared_ptr<T> _W;
+        std::shared_ptr<T> _B;
+        std::shared_ptr<T> _Wp; // Filtros empaquetados para la GEMM
+        bool _packed = false;
+
+        // Longitud que cabe en uint16_t o 0 (la capa queda con BUILD_ERROR_0)
+        static uint16_t len16(size_t n) {return n <= UINT16_MAX ? n : 0;}
+        void allocate()
+        {
+            const size_t len = size_t(_p.filters)*_p.kernelLen();
+            this->_W = std::shared_ptr<T>{new T[len], std::default_delete<T[]>()};
+            this->_B = std::shared_ptr<T>{new T[_p.filters], std::default_delete<T[]>()};
+            if(this->_code == OPCODE::OK && (_p.channels == 0 || _p.filters == 0 || _p.outputLen() == 0))
+                this->_code = OPCODE::BUILD_ERROR_2;
+        }
+        void convolve(const T* in, T* out) const
+        {
+            const size_t F = _p.filters, K = _p.kernelLen();
+            const dim_t o = _p.output();
+            const size_t P = size_t(o.rows)*o.cols;
+            const size_t tile = kernels::convTile<T>(K);
+            const size_t tiles = (P+tile-1)/tile;
+            auto run = [&](size_t t0, size_t t1){
+                thread_local std::vector<T> col, y;
+                if(col.size() < tile*K)
+                    col.resize(tile*K);
+                if(y.size() < tile*F)
+                    y.resize(tile*F);
+                for(size_t t = t0; t < t1; ++t)
+                    kernels::conv2dTile(in, _Wp.get(), _B.get(), out, _p, t*tile, std::min(P, (t+1)*tile), col.data(), y.data());
+            };
+            // Con pool y trabajo suficiente cada hilo calcula bloques de salidas
+            if(this->_pool && P*K*F >= NN_PARALLEL_MIN_WORK)
+                this->_pool->parallel_for(tiles, this->_pool->grainFor(tiles), run);
+            else
+                run(0, tiles);
+        }
+    public:
+        Conv2DLayer() = delete;
+        Conv2DLayer(const Conv2DParams &params) : GenericLayer<T>(len16(params.inputLen()), len16(params.outputLen())), _p(params) {allocate();}
+        Conv2DLayer(const Conv2DParams &params, const std::shared_ptr<T> &input_block) : GenericLayer<T>(len16(params.inputLen()), input_block, len16(params.outputLen())), _p(params) {allocate();}
+        Conv2DLayer(const GenericLayer<T>* prev_layer, const Conv2DParams &params) : GenericLayer<T>(prev_layer, len16(params.outputLen())), _p(params)
+        {
+            allocate();
+            if(this->_code == OPCODE::OK && params.inputLen() != prev_layer->getOutputSize())
+                this->_code = OPCODE::BUILD_ERROR_2;
+        }
+        Conv2DLayer(const Conv2DLayer<T> &layer) : GenericLayer<T>(layer), _p(layer._p)
+        {
+            const size_t len = size_t(_p.filters)*_p.kernelLen();
+            this->_W = std::shared_ptr<T>{new T[len], std::default_delete<T[]>()};
+            this->_B = std::shared_ptr<T>{new T[_p.filters], std::default_delete<T[]>()};
+            std::copy(layer._W.get(), layer._W.get()+len, this->_W.get());
+            std::copy(layer._B.get(), layer._B.get()+_p.filters, this->_B.get());
+            if(layer._packed)
+                pack();
+        }
+        void compute() override
+        {
+            if(this->_code != OPCODE::OK)
+            {
+                this->_code = OPCODE::OP_ERROR_0;
+                return;
+            }
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            if(!_packed)
+                return OPCODE::CONF_ERROR_0;
+            for(size_t k = 0; k < n; ++k)
+                convolve(in+k*this->_size_i, out+k*this->_size_o);
+            return OPCODE::OK;
+        }
+        /* Empaqueta los filtros para la GEMM. Necesario tras modificarlos con
+           getMutWeights() (Net::init() lo hace si hace falta). */
+        void pack()
+        {
+            const size_t F = _p.filters, K = _p.kernelLen();
+            if(!_Wp)
+                _Wp = std::shared_ptr<T>{new T[kernels::packedSize<T>(F, K)], std::default_delete<T[]>()};
+            kernels::packWeights(this->_W.get(), F, K, _Wp.get());
+            _packed = true;
+        }
+        bool packed() const {return _packed;}
+        const Conv2DParams& getParams() const {return _p;}
+        dim_t getOutputDim() const {return _p.output();}
+        T* getWeights() const {return this->_W.get();}
+        T* getMutWeights() {_packed = false; return this->_W.get();}
+        T* getBias() const {return this->_B.get();}
+        T* getMutBias() {return this->_B.get();}
+        void loadWeights(FILE* fptr)
+        {
+            OPCODE ret = parseStatus(parseCSV(fptr, this->_W.get(), size_t(_p.filters)*_p.kernelLen()));
+            if(ret != OPCODE::OK)
+                this->_code = ret;
+            pack();
+        }
+        void loadBias(FILE* fptr)
+        {
+            OPCODE ret = parseStatus(parseCSV(fptr, this->_B.get(), _p.filters));
+            if(ret != OPCODE::OK)
+                this->_code = ret;
+        }
+        void loadWeights(const char* filename)
+        {
+            FILE* f = fopen(filename, "r");
+            loadWeights(f);
+            if(f)
+                fclose(f);
+        }
+        void loadBias(const char* filename)
+        {
+            FILE* f = fopen(filename, "r");
+            loadBias(f);
+            if(f)
+                fclose(f);
+        }
+        const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<Conv2DLayer<T>>(*this);}
+};
+
+/* Pooling sin relleno sobre una imagen de un canal (ver PoolParams). Base de
+   MaxPoolLayer y AvgPoolLayer. Si va justo detrás de un ConvLayer, Net::init()
+   la fusiona con la convolución y esta capa no se ejecuta. */
+template<typename T = float>
+class PoolLayer : public GenericLayer<T>
+{
+    private:
+        friend class Net<T>;
+    protected:
+        PoolParams _p;
+        PoolMode _mode;
+
+        // Longitud que cabe en uint16_t o 0 (la capa queda con BUILD_ERROR_0)
+        static uint16_t len16(size_t n) {return n <= UINT16_MAX ? n : 0;}
+        void check()
+        {
+            if(this->_code == OPCODE::OK && _p.outputLen() == 0)
+                this->_code = OPCODE::BUILD_ERROR_2;
+        }
+    public:
+        PoolLayer() = delete;
+        PoolLayer(const PoolParams &params, PoolMode mode) : GenericLayer<T>(len16(params.inputLen()), len16(params.outputLen())), _p(params), _mode(mode) {check();}
+        PoolLayer(const PoolParams &params, PoolMode mode, const std::shared_ptr<T> &input_block) : GenericLayer<T>(len16(params.inputLen()), input_block, len16(params.outputLen())), _p(params), _mode(mode) {check();}
+        PoolLayer(const GenericLayer<T>* prev_layer, const PoolParams &params, PoolMode mode) : GenericLayer<T>(prev_layer, len16(params.outputLen())), _p(params), _mode(mode)
+        {
+            check();
+            if(this->_code == OPCODE::OK && params.inputLen() != prev_layer->getOutputSize())
+                this->_code = OPCODE::BUILD_ERROR_2;
+            // Detrás de una convolución la forma también tiene que coincidir, no solo la longitud
+            auto cptr = dynamic_cast<const ConvLayer<T>*>(prev_layer);
+            if(this->_code == OPCODE::OK && cptr && (cptr->getDim().rows != _p.input.rows || cptr->getDim().cols != _p.input.cols))
+                this->_code = OPCODE::BUILD_ERROR_2;
+        }
+
+        void compute() override
+        {
+            if(this->_code != OPCODE::OK)
+            {
+                this->_code = OPCODE::OP_ERROR_0;
+                return;
+            }
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            const dim_t o = _p.output();
+            const size_t ld = _p.input.cols;
+            for (size_t k = 0; k < n; k++)
+            {
+                const T* src = in + k*this->_size_i;
+                T* dst = out + k*this->_size_o;
+                for (size_t r = 0; r < o.rows; r++)
+                    kernels::poolRow(src + r*_p.stride.rows*ld, ld, dst + r*o.cols, o.cols, _p.size.rows, _p.size.cols, _p.stride.cols, _mode);
+            }
+            return OPCODE::OK;
+        }
+        const PoolParams& getParams() const {return _p;}
+        dim_t getOutputDim() const {return _p.output();}
+        PoolMode getMode() const {return _mode;}
+};
+
+template<typename T = float>
+class MaxPoolLayer final : public PoolLayer<T>
+{
+    private:
+        friend class Net<T>;
+        static const char _id[];
+    public:
+        MaxPoolLayer(const PoolParams &params) : PoolLayer<T>(params, PoolMode::MAX) {}
+        MaxPoolLayer(const PoolParams &params, const std::shared_ptr<T> &input_block) : PoolLayer<T>(params, PoolMode::MAX, input_block) {}
+        MaxPoolLayer(const GenericLayer<T>* prev_layer, const PoolParams &params) : PoolLayer<T>(prev_layer, params, PoolMode::MAX) {}
+        const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<MaxPoolLayer<T>>(*this);}
+};
+
+template<typename T = float>
+class AvgPoolLayer final : public PoolLayer<T>
+{
+    private:
+        friend class Net<T>;
+        static const char _id[];
+    public:
+        AvgPoolLayer(const PoolParams &params) : PoolLayer<T>(params, PoolMode::AVG) {}
+        AvgPoolLayer(const PoolParams &params, const std::shared_ptr<T> &input_block) : PoolLayer<T>(params, PoolMode::AVG, input_block) {}
+        AvgPoolLayer(const GenericLayer<T>* prev_layer, const PoolParams &params) : PoolLayer<T>(prev_layer, params, PoolMode::AVG) {}
         const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<AvgPoolLayer<T>>(*this);}
 };
 
 
@@ -518,6 +1360,7 @@ class SigmoidLayer final : public GenericLayer<T>
     private:
         friend class Net<T>;
         static const char _id[];
+        ActMode _mode = ActMode::FAST;
     public:
         SigmoidLayer() = delete;
         SigmoidLayer(const uint16_t &layer_len) : GenericLayer<T>(layer_len, layer_len){};
@@ -532,48 +1375,496 @@ class SigmoidLayer final : public GenericLayer<T>
                 this->_code = OPCODE::OP_ERROR_0;
                 return;
             }
-            for (size_t i = 0; i < this->_size_i; i++)
-            {
-                this->_out.get()[i] = 1.0/(1.0+exp(-this->_in.get()[i]));
-            }
+            this->_code = computeBatch(this->_in.get(), this->_out.get(), 1);
+        }
+        OPCODE computeBatch(const T* in, T* out, size_t n) const override
+        {
+            kernels::sigmoid(in, out, n*this->_size_i, _mode);
+            return OPCODE::OK;
         }
+        void setMode(ActMode mode) {_mode = mode;}
+        ActMode getMode() const {return _mode;}
+        bool inplace() const override {return true;}
         const char* id() const override {return this->_id;}
+        std::shared_ptr<GenericLayer<T>> clone() const override {return std::make_shared<SigmoidLayer<T>>(*this);}
 };
 
 template<typename T> const char GenericLayer<T>::_id[] = "Generic";
 template<typename T> const char LambdaLayer<T>::_id[] = "Lambda";
 template<typename T> const char WGLayer<T>::_id[] = "WG";
+template<typename T> const char QuantWGLayer<T>::_id[] = "QWG";
 template<typename T> const char ReLuLayer<T>::_id[] = "ReLu";
 template<typename T> const char NormLayer<T>::_id[] = "Normalize";
 template<typename T> const char SoftMaxLayer<T>::_id[] = "SoftMax";
 template<typename T> const char ConvLayer<T>::_id[] = "Convolution";
+template<typename T> const char Conv2DLayer<T>::_id[] = "Conv2D";
+template<typename T> const char MaxPoolLayer<T>::_id[] = "MaxPool";
+template<typename T> const char AvgPoolLayer<T>::_id[] = "AvgPool";
 template<typename T> const char SigmoidLayer<T>::_id[] = "Sigmoid";
 
+template<typename T = float> class Model;
+
+namespace detail{
+
+inline void reportError(EXCEPLEVEL lv, OPCODE code, int n, const char* id)
+{
+    if(code == OPCODE::OK)
+        return;
+    switch (lv)
+    {
+    case EXCEPLEVEL::THROW_ALL:
+        throw NetError(code, n, id);
+        break;
+    case EXCEPLEVEL::CERR:
+        std::cerr << code << " in layer " << n << " [type:" << id << "]" << std::endl;
+        break;
+    default:
+        break;
+    }
+}
+
+/* Pasada por lotes in[n][inputs] -> out[n][outputs] sobre una lista de capas,
+   en bloques de NN_BATCH_TILE muestras con dos buffers ping-pong del llamante.
+   Las capas absorbidas por fusión se saltan. No toca los _in/_out de las capas,
+   así que varios hilos pueden recorrer las mismas capas con buffers distintos.
+   Con prof se registra el tiempo de cada capa por bloque, repartido entre sus
+   muestras (las mismas unidades que en compute()). */
+template<typename T, typename LayerPtr, typename Report>
+void runBatch(const std::vector<LayerPtr> &layers, const T* in, T* out, size_t n, std::vector<T> (&buff)[2], Report &&report,
+              Profile* prof = nullptr)
+{
+    size_t width = 0;
+    size_t last = 0; // Última capa que se ejecuta
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        width = std::max<size_t>(width, layers[i]->getOutputSize());
+        if (!layers[i]->fused())
+            last = i;
+    }
+    const size_t tile_max = std::min<size_t>(NN_BATCH_TILE, n);
+    for (auto &b : buff)
+    {
+        if(b.size() < width*tile_max)
+            b.resize(width*tile_max);
+    }
+
+    const size_t si = layers.front()->getInputSize();
+    const size_t so = layers.back()->getOutputSize();
+    for (size_t k = 0; k < n; k += NN_BATCH_TILE)
+    {
+        size_t tile = std::min<size_t>(NN_BATCH_TILE, n-k);
+        const T* src = in + k*si;
+        int cur = -1; // Buffer que contiene src (-1: la entrada del usuario)
+        for (size_t i = 0; i <= last; i++)
+        {
+            auto &layer = layers[i];
+            if (layer->fused())
+                continue;
+            T* dst;
+            if (i == last)
+                dst = out + k*so;
+            else if (cur >= 0 && layer->inplace())
+                dst = buff[cur].data();
+            else
+            {
+                cur = (cur == 0) ? 1 : 0;
+                dst = buff[cur].data();
+            }
+            if (NN_PROFILE && prof)
+            {
+                auto t0 = Profile::clock::now();
+                OPCODE code = layer->computeBatch(src, dst, tile);
+                prof->record(i, Profile::elapsed(t0, Profile::clock::now()), tile);
+                report(code, i, layer->id());
+            }
+            else
+                report(layer->computeBatch(src, dst, tile), i, layer->id());
+            src = dst;
+        }
+    }
+}
+
+}
+
 template<typename T>
 class Net
 {
     static_assert(std::is_floating_point<T>::value, "A Net class can only be instantiated with floating point types.");
     private:
-        uint16_t _input_size, _output_size;
+        friend class Model<T>;
+        uint16_t _input_size, _output_size = 0;
         std::vector<std::shared_ptr<GenericLayer<T>>> _layer_list;
         std::shared_ptr<T> _in;
         std::shared_ptr<T> _out;
+        std::vector<T> _batch_buff[2]; // Buffers ping-pong de computeBatch
+        struct Scratch {std::vector<T> buff[2];};
+        std::vector<Scratch> _worker_buff; // Buffers de cada worker de computeParallel
+        std::shared_ptr<T> _arena;     // Activaciones de todas las capas
+        size_t _arena_len = 0;
         EXCEPLEVEL _exlv = EXCEPLEVEL::THROW_ALL;
+        OPTLEVEL _optlv = OPTLEVEL::NONE;
+        std::shared_ptr<ThreadPool> _pool; // Se asigna a las capas en init()
+        std::vector<std::string> _rewrites; // Reescrituras aplicadas por init()
+        bool _profiling = false;
+        uint32_t _profile_every = 1; // Se perfila una de cada _profile_every pasadas
+        uint32_t _profile_tick = 0;
+        Profile _profile;
+
+        // Decide si esta pasada se perfila
+        bool sampleProfile()
+        {
+            if (!NN_PROFILE || !_profiling)
+                return false;
+            if (++_profile_tick < _profile_every)
+                return false;
+            _profile_tick = 0;
+            if (_profile.size() != _layer_list.size())
+                resetProfile();
+            return true;
+        }
+        // Ajusta el perfil a la lista de capas (tras init() cambian las fusiones)
+        void resetProfile()
+        {
+            std::vector<std::string> ids;
+            std::vector<bool> fused;
+            for (auto &layer : _layer_list)
+            {
+                ids.emplace_back(layer->id());
+                fused.push_back(layer->fused());
+            }
+            _profile.setLayers(std::move(ids), std::move(fused));
+        }
+
+        /* Planificador de memoria de activaciones.
+           Cada salida vive desde su capa hasta la siguiente (la última hasta el
+           final). Las capas elemento a elemento escriben sobre su entrada y
+           prolongan la vida de ese bloque, salvo si la entrada es la de la red.
+           Las capas fusionadas también comparten el bloque de la anterior, que
+           es la que escribe su salida.
+           Los bloques se reparten de forma voraz en huecos de una sola arena
+           alineada: en una cadena quedan dos huecos que se alternan. */
+        void planMemory()
+        {
+            const size_t L = _layer_list.size();
+            std::vector<size_t> group(L), gsize, gdef, gend;
+            for (size_t k = 0; k < L; k++)
+            {
+                auto &layer = _layer_list[k];
+                if (k > 0 && (layer->inplace() || layer->_fused))
+                {
+                    group[k] = group[k-1];
+                    gsize[group[k]] = std::max<size_t>(gsize[group[k]], layer->_size_o);
+                }
+                else
+                {
+                    group[k] = gsize.size();
+                    gsize.push_back(layer->_size_o);
+                    gdef.push_back(k);
+                    gend.push_back(k);
+                }
+                gend[group[k]] = (k+1 < L) ? k+1 : L;
+            }
+
+            std::vector<size_t> slot_size, slot_busy, gslot(gsize.size());
+            for (size_t g = 0; g < gsize.size(); g++)
+            {
+                size_t s = 0;
+                while (s < slot_size.size() && slot_busy[s] >= gdef[g])
+                    ++s;
+                if (s == slot_size.size())
+                {
+                    slot_size.push_back(0);
+                    slot_busy.push_back(0);
+                }
+                slot_size[s] = std::max(slot_size[s], gsize[g]);
+                slot_busy[s] = gend[g];
+                gslot[g] = s;
+            }
+
+            std::vector<size_t> slot_offset(slot_size.size());
+            _arena_len = 0;
+            for (size_t s = 0; s < slot_size.size(); s++)
+            {
+                slot_offset[s] = _arena_len;
+                _arena_len += alignedLen<T>(slot_size[s]);
+            }
+            _arena = alignedBlock<T>(_arena_len);
+
+            for (size_t k = 0; k < L; k++)
+            {
+                auto &layer = _layer_list[k];
+                layer->_in = (k == 0) ? _in : _layer_list[k-1]->_out;
+                layer->_out = std::shared_ptr<T>(_arena, _arena.get() + slot_offset[gslot[group[k]]]);
+            }
+        }
+
+        static bool isIdentity(const GenericLayer<T>* layer)
+        {
+            const size_t n = layer->_size_i;
+            if (auto nptr = dynamic_cast<const NormLayer<T>*>(layer))
+            {
+                for (size_t j = 0; j < n; j++)
+                    if (nptr->_M.get()[j] != T(0) || nptr->_S.get()[j] != T(1))
+                        return false;
+                return true;
+            }
+            if (auto wgptr = dynamic_cast<const WGLayer<T>*>(layer))
+            {
+                if (layer->_size_o != n)
+                    return false;
+                for (size_t i = 0; i < n; i++)
+                {
+                    if (wgptr->_B.get()[i] != T(0))
+                        return false;
+                    for (size_t j = 0; j < n; j++)
+                        if (wgptr->_W.get()[i*n+j] != T(i == j ? 1 : 0))
+                            return false;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        /* Plegado algebraico del grafo (opt_level(OPTLEVEL::FOLD)):
+             - elimina capas identidad (Norm con M=0,S=1 y WG unidad sin sesgo),
+             - Norm->WG: W'[i][j] = W[i][j]/S[j], B'[i] = B[i] - sum_j W'[i][j]*M[j],
+             - WG->WG:   W = W2*W1, B = W2*B1 + B2, si no aumenta el número de pesos.
+           Solo se tocan capas sin errores y el resultado va siempre en una WG
+           nueva: los pesos originales pueden ser del usuario o de otra red
+           (addWGLayer con shared_ptr, shareWeights). Los índices de rewrites()
+           son los originales de la red. */
+        void foldLayers()
+        {
+            _rewrites.clear();
+            std::vector<int> orig(_layer_list.size());
+            for (size_t k = 0; k < orig.size(); k++)
+                orig[k] = k;
+            auto tag = [&](size_t k){
+                return std::string(_layer_list[k]->id()) + "[" + std::to_string(orig[k]) + "]";
+            };
+            auto erase = [&](size_t k){
+                _layer_list.erase(_layer_list.begin()+k);
+                orig.erase(orig.begin()+k);
+            };
+
+            for (size_t k = 0; k < _layer_list.size() && _layer_list.size() > 1; )
+            {
+                auto layer = _layer_list[k].get();
+                if (layer->code() == OPCODE::OK && isIdentity(layer))
+                {
+                    _rewrites.push_back("remove identity " + tag(k));
+                    erase(k);
+                }
+                else
+                    ++k;
+            }
+
+            for (size_t k = 0; k+1 < _layer_list.size(); )
+            {
+                auto nptr = dynamic_cast<NormLayer<T>*>(_layer_list[k].get());
+                auto wgptr = dynamic_cast<WGLayer<T>*>(_layer_list[k+1].get());
+                if (!nptr || !wgptr || nptr->code() != OPCODE::OK || wgptr->code() != OPCODE::OK)
+                {
+                    ++k;
+                    continue;
+                }
+                const size_t rows = wgptr->_size_o, cols = wgptr->_size_i;
+                const T* M = nptr->_M.get();
+                const T* S = nptr->_S.get();
+                if (std::find(S, S+cols, T(0)) != S+cols)
+                {
+                    ++k;
+                    continue;
+                }
+                // En una capa nueva, como al unir WG->WG: _W y _B pueden ser bloques del usuario (shareWeights)
+                auto folded = std::make_shared<WGLayer<T>>(wgptr->_size_i, nptr->_in, wgptr->_size_o);
+                T* W = folded->getMutWeights();
+                T* B = folded->getMutBias();
+                const T* W0 = wgptr->_W.get();
+                const T* B0 = wgptr->_B.get();
+                for (size_t i = 0; i < rows; i++)
+                {
+                    B[i] = B0[i];
+                    for (size_t j = 0; j < cols; j++)
+                    {
+                        W[i*cols+j] = W0[i*cols+j]/S[j];
+                        B[i] -= W[i*cols+j]*M[j];
+                    }
+                }
+                folded->_wfmt = wgptr->_wfmt;
+                _rewrites.push_back("fold " + tag(k) + " into " + tag(k+1));
+                _layer_list[k+1] = folded;
+                erase(k);
+            }
+
+            for (size_t k = 0; k+1 < _layer_list.size(); )
+            {
+                auto w1 = dynamic_cast<WGLayer<T>*>(_layer_list[k].get());
+                auto w2 = dynamic_cast<WGLayer<T>*>(_layer_list[k+1].get());
+                if (!w1 || !w2 || w1->code() != OPCODE::OK || w2->code() != OPCODE::OK)
+                {
+                    ++k;
+                    continue;
+                }
+                const size_t in = w1->_size_i, mid = w1->_size_o, out = w2->_size_o;
+                if (in*out > in*mid + mid*out)
+                {
+                    ++k;
+                    continue;
+                }
+                auto merged = std::make_shared<WGLayer<T>>(w1->_size_i, w1->_in, w2->_size_o);
+                T* W = merged->getMutWeights();
+                T* B = merged->getMutBias();
+                const T* W1 = w1->_W.get();
+                const T* W2 = w2->_W.get();
+                for (size_t i = 0; i < out; i++)
+                {
+                    T acc = w2->_B.get()[i];
+                    for (size_t m = 0; m < mid; m++)
+                        acc += W2[i*mid+m]*w1->_B.get()[m];
+                    B[i] = acc;
+                    for (size_t j = 0; j < in; j++)
+                    {
+                        T w = 0;
+                        for (size_t m = 0; m < mid; m++)
+                            w += W2[i*mid+m]*W1[m*in+j];
+                        W[i*in+j] = w;
+                    }
+                }
+                if (w1->_wfmt == w2->_wfmt)
+                    merged->_wfmt = w1->_wfmt;
+                _rewrites.push_back("merge " + tag(k) + " and " + tag(k+1));
+                _layer_list[k] = merged;
+                erase(k+1);
+            }
+        }
+
+        /* Fusión WG+activación: el WG aplica ReLu/Sigmoide/SoftMax al escribir
+           su salida y la capa de activación queda absorbida (no se ejecuta).
+           Como la activación es in-place comparte bloque con el WG.
+           Fusión Conv+pooling: ConvLayer reduce cada banda de filas al
+           calcularla y escribe directamente la salida del pooling. */
+        void fuseLayers()
+        {
+            for (auto &layer : _layer_list)
+            {
+                layer->_fused = false;
+                if (auto wgptr = dynamic_cast<WGLayer<T>*>(layer.get()))
+                    wgptr->setEpilogue(Epilogue::NONE);
+                if (auto cptr = dynamic_cast<ConvLayer<T>*>(layer.get()))
+                    cptr->clearPooling();
+            }
+            #ifndef NN_NO_FUSION
+            for (size_t k = 1; k < _layer_list.size(); k++)
+            {
+                auto wgptr = dynamic_cast<WGLayer<T>*>(_layer_list[k-1].get());
+                auto act = _layer_list[k].get();
+                if (!wgptr || wgptr->code() != OPCODE::OK || act->code() != OPCODE::OK)
+                    continue;
+                if (dynamic_cast<ReLuLayer<T>*>(act))
+                    wgptr->setEpilogue(Epilogue::RELU);
+                else if (auto sptr = dynamic_cast<SigmoidLayer<T>*>(act))
+                    wgptr->setEpilogue(Epilogue::SIGMOID, sptr->getMode());
+                else if (auto smptr = dynamic_cast<SoftMaxLayer<T>*>(act))
+                    wgptr->setEpilogue(Epilogue::SOFTMAX, smptr->getMode());
+                else
+                    continue;
+                act->_fused = true;
+            }
+            for (size_t k = 1; k < _layer_list.size(); k++)
+            {
+                auto cptr = dynamic_cast<ConvLayer<T>*>(_layer_list[k-1].get());
+                auto pptr = dynamic_cast<PoolLayer<T>*>(_layer_list[k].get());
+                if (!cptr || !pptr || cptr->code() != OPCODE::OK || pptr->code() != OPCODE::OK)
+                    continue;
+                if (pptr->_p.input.rows != cptr->_dim.rows || pptr->_p.input.cols != cptr->_dim.cols)
+                    continue;
+                cptr->setPooling(pptr->_p, pptr->_mode);
+                pptr->_fused = true;
+            }
+            #endif
+        }
+
+        void report(OPCODE code, int n, const char* id)
+        {
+            detail::reportError(_exlv, code, n, id);
+        }
+        // compute() midiendo cada capa
+        void computeProfiled()
+        {
+            const auto start = Profile::clock::now();
+            int n = 0;
+            for(auto &layer: this->_layer_list)
+            {
+                report(layer->code(), n, layer->id());
+                if(!layer->_fused)
+                {
+                    auto t0 = Profile::clock::now();
+                    layer->compute();
+                    _profile.record(n, Profile::elapsed(t0, Profile::clock::now()));
+                }
+                ++n;
+            }
+            _profile.recordNet(Profile::elapsed(start, Profile::clock::now()));
+        }
     public:
         Net() = delete;
         Net(const uint16_t &input_len) : _input_size(input_len)
         {
-            _in = std::shared_ptr<T>{new T[input_len]};
+            _in = std::shared_ptr<T>{new T[input_len], std::default_delete<T[]>()};
         }
-        Net(const Net<T> &net) : _layer_list(std::move(net._layer_list))
+        // Copia profunda: capas y pesos propios. Si net estaba inicializada, la copia también.
+        Net(const Net<T> &net) : _input_size(net._input_size), _output_size(net._output_size), _exlv(net._exlv), _optlv(net._optlv), _pool(net._pool), _rewrites(net._rewrites),
+                                  _profiling(net._profiling), _profile_every(net._profile_every)
         {
-            this->_input_size = net._input_size;
-            this->_output_size = net._output_size;
-            this->_in = std::move(net._in);
-            this->_out = std::move(net._out);
+            _in = std::shared_ptr<T>{new T[_input_size], std::default_delete<T[]>()};
+            std::copy(net._in.get(), net._in.get()+_input_size, _in.get());
+            for (auto &layer : net._layer_list)
+            {
+                _layer_list.push_back(layer->clone());
+                auto &copy = _layer_list.back();
+                copy->_in = (_layer_list.size() == 1) ? _in : _layer_list[_layer_list.size()-2]->_out;
+            }
+            if (net._arena)
+                planMemory();
+            if (net._out && !_layer_list.empty())
+                _out = _layer_list.back()->_out;
+            resetProfile();
+        }
+        Net(Net<T> &&net) = default;
+        Net<T>& operator=(const Net<T> &net)
+        {
+            if (this != &net)
+                *this = Net<T>(net);
+            return *this;
         }
+        Net<T>& operator=(Net<T> &&net) = default;
 
         void except_level(EXCEPLEVEL lv) {_exlv=lv;};
+        void opt_level(OPTLEVEL lv) {_optlv=lv;};
+
+        /* Perfilado por capa de compute() y computeBatch() (computeParallel no se
+           perfila). every > 1 perfila solo una de cada every pasadas para poder
+           dejarlo activo en producción. Cambiarlo no borra lo acumulado. */
+        void setProfiling(bool on, uint32_t every = 1)
+        {
+            _profiling = on;
+            _profile_every = std::max<uint32_t>(1, every);
+            _profile_tick = 0;
+            if (_profile.size() != _layer_list.size())
+                resetProfile();
+        }
+        bool profiling() const {return _profiling;}
+        const Profile& profile() const {return _profile;}
+        void clearProfile() {_profile.reset();}
+        // Reescrituras aplicadas en el último init(), p. ej. "fold Normalize[0] into WG[1]"
+        const std::vector<std::string>& rewrites() const {return _rewrites;}
+
+        /* Hilos para repartir WG y Conv grandes (ver NN_PARALLEL_MIN_WORK).
+           Se aplica en init(). setThreads(1) o setThreadPool(nullptr) lo desactiva. */
+        void setThreads(size_t n) {_pool = n > 1 ? std::make_shared<ThreadPool>(n) : nullptr;}
+        void setThreadPool(std::shared_ptr<ThreadPool> pool) {_pool = std::move(pool);}
+        std::shared_ptr<ThreadPool> getThreadPool() const {return _pool;}
 
         // Lambda
         void addLambdaLayer(const uint16_t &output_len, std::function<void(T*, T*, uint16_t, uint16_t)> app)
@@ -591,7 +1882,7 @@ class Net
         }
         
         // WG
-        void addWGLayer(const uint16_t &output_len, T* w_first, T* s_first)
+        void addWGLayer(const uint16_t &output_len, T* w_first, T* s_first, WeightFormat fmt = WeightFormat::NATIVE)
         {
             if (_layer_list.empty())
             {
@@ -606,8 +1897,9 @@ class Net
                       w_first + (wgptr->getInputSize()*wgptr->getOutputSize()),
                       wgptr->getMutWeights());      
             std::copy(s_first, s_first+wgptr->getOutputSize(), wgptr->getMutBias());     
+            wgptr->setWeightFormat(fmt);
         }
-        void addWGLayer(const uint16_t &output_len, const char* file_w, const char* file_s)
+        void addWGLayer(const uint16_t &output_len, const char* file_w, const char* file_s, WeightFormat fmt = WeightFormat::NATIVE)
         {
             if (_layer_list.empty())
             {
@@ -620,6 +1912,52 @@ class Net
             auto nptr = dynamic_cast<WGLayer<T>*>(_layer_list.back().get());
             nptr->loadWeights(file_w);
             nptr->loadBias(file_s);
+            if(fmt != WeightFormat::NATIVE)
+                nptr->setWeightFormat(fmt);
+        }
+        // Sin copia: la capa comparte los bloques (Wp opcional, ya empaquetado)
+        void addWGLayer(const uint16_t &output_len, std::shared_ptr<T> w, std::shared_ptr<T> s, std::shared_ptr<T> wp = nullptr)
+        {
+            if (_layer_list.empty())
+            {
+                _layer_list.emplace_back(new WGLayer<T>(_input_size, _in, output_len));
+            }
+            else
+            {
+                _layer_list.emplace_back(new WGLayer<T>(_layer_list.back().get(), output_len));
+            }
+            auto wgptr = dynamic_cast<WGLayer<T>*>(_layer_list.back().get());
+            wgptr->shareWeights(std::move(w), std::move(s), std::move(wp));
+        }
+
+        // WG cuantizada (int8): los pesos en T se cuantizan al añadir la capa
+        void addQuantWGLayer(const uint16_t &output_len, T* w_first, T* s_first)
+        {
+            if (_layer_list.empty())
+            {
+                _layer_list.emplace_back(new QuantWGLayer<T>(_input_size, _in, output_len));
+            }
+            else
+            {
+                _layer_list.emplace_back(new QuantWGLayer<T>(_layer_list.back().get(), output_len));
+            }
+            auto qptr = dynamic_cast<QuantWGLayer<T>*>(_layer_list.back().get());
+            qptr->quantize(w_first);
+            std::copy(s_first, s_first+qptr->getOutputSize(), qptr->getMutBias());
+        }
+        void addQuantWGLayer(const uint16_t &output_len, const char* file_w, const char* file_s)
+        {
+            if (_layer_list.empty())
+            {
+                _layer_list.emplace_back(new QuantWGLayer<T>(_input_size, _in, output_len));
+            }
+            else
+            {
+                _layer_list.emplace_back(new QuantWGLayer<T>(_layer_list.back().get(), output_len));
+            }
+            auto qptr = dynamic_cast<QuantWGLayer<T>*>(_layer_list.back().get());
+            qptr->loadWeights(file_w);
+            qptr->loadBias(file_s);
         }
 
         // Normalize
@@ -651,6 +1989,20 @@ class Net
             nptr->loadMeans(file_m);
             nptr->loadSD(file_sd);
         }
+        // Sin copia: la capa comparte los bloques
+        void addNormLayer(std::shared_ptr<T> m, std::shared_ptr<T> sd)
+        {
+            if (_layer_list.empty())
+            {
+                _layer_list.emplace_back(new NormLayer<T>(_input_size, _in));
+            }
+            else
+            {
+                _layer_list.emplace_back(new NormLayer<T>(_layer_list.back().get()));
+            }
+            auto nptr = dynamic_cast<NormLayer<T>*>(_layer_list.back().get());
+            nptr->shareStats(std::move(m), std::move(sd));
+        }
 
         // Relu
         void addReLuLayer()
@@ -727,6 +2079,62 @@ class Net
             addConvLayer(dimensions, kernel, padding);
         }
 
+        // Conv2D: W[filtros][canales][kh][kw], B[filtros]
+        void addConv2DLayer(const Conv2DParams &params, T* w_first, T* b_first)
+        {
+            if (_layer_list.empty())
+            {
+                _layer_list.emplace_back(new Conv2DLayer<T>(params, _in));
+                if (params.inputLen() != _input_size)
+                    _layer_list.back()->_code = OPCODE::BUILD_ERROR_2;
+            }
+            else
+            {
+                _layer_list.emplace_back(new Conv2DLayer<T>(_layer_list.back().get(), params));
+            }
+            auto cptr = dynamic_cast<Conv2DLayer<T>*>(_layer_list.back().get());
+            std::copy(w_first, w_first + size_t(params.filters)*params.kernelLen(), cptr->getMutWeights());
+            std::copy(b_first, b_first + params.filters, cptr->getMutBias());
+            cptr->pack();
+        }
+        void addConv2DLayer(const Conv2DParams &params, const char* file_w, const char* file_b)
+        {
+            if (_layer_list.empty())
+            {
+                _layer_list.emplace_back(new Conv2DLayer<T>(params, _in));
+                if (params.inputLen() != _input_size)
+                    _layer_list.back()->_code = OPCODE::BUILD_ERROR_2;
+            }
+            else
+            {
+                _layer_list.emplace_back(new Conv2DLayer<T>(_layer_list.back().get(), params));
+            }
+            auto cptr = dynamic_cast<Conv2DLayer<T>*>(_layer_list.back().get());
+            cptr->loadWeights(file_w);
+            cptr->loadBias(file_b);
+        }
+
+        // Pooling: MaxPoolLayer (PoolMode::MAX) o AvgPoolLayer (PoolMode::AVG)
+        void addPoolLayer(const PoolParams &params, PoolMode mode = PoolMode::MAX)
+        {
+            if (_layer_list.empty())
+            {
+                if (mode == PoolMode::MAX)
+                    _layer_list.emplace_back(new MaxPoolLayer<T>(params, _in));
+                else
+                    _layer_list.emplace_back(new AvgPoolLayer<T>(params, _in));
+                if (params.inputLen() != _input_size)
+                    _layer_list.back()->_code = OPCODE::BUILD_ERROR_2;
+            }
+            else
+            {
+                if (mode == PoolMode::MAX)
+                    _layer_list.emplace_back(new MaxPoolLayer<T>(_layer_list.back().get(), params));
+                else
+                    _layer_list.emplace_back(new AvgPoolLayer<T>(_layer_list.back().get(), params));
+            }
+        }
+
         // Sigmoide
         void addSigmoidLayer()
         {
@@ -743,26 +2151,85 @@ class Net
         // Computar
         void compute()
         {
+            if(sampleProfile())
+            {
+                computeProfiled();
+                return;
+            }
             int n = 0;
             for(auto &layer: this->_layer_list)
             {
-                auto code = layer->code();
-                switch (_exlv)
-                {
-                case EXCEPLEVEL::THROW_ALL:
-                    if(code != OPCODE::OK)
-                        throw NetError(code, n, layer->id());
-                    break;
-                case EXCEPLEVEL::CERR:
-                    if(code != OPCODE::OK)
-                        std::cerr << code << " in layer " << n << " [type:" << layer->id() << "]" << std::endl;
-                    break;
-                }
-                layer->compute();
+                report(layer->code(), n, layer->id());
+                if(!layer->_fused)
+                    layer->compute();
                 ++n;
             }
         }
 
+        // Computar un lote de n muestras contiguas: in[n][inputs] -> out[n][outputs]
+        void computeBatch(const T* in, T* out, size_t n)
+        {
+            if(_layer_list.empty() || n == 0)
+                return;
+            int l = 0;
+            for(auto &layer: this->_layer_list)
+                report(layer->code(), l++, layer->id());
+            const bool prof = sampleProfile();
+            Profile::clock::time_point t0;
+            if(prof)
+                t0 = Profile::clock::now();
+            detail::runBatch(_layer_list, in, out, n, _batch_buff,
+                             [this](OPCODE code, int i, const char* id){report(code, i, id);},
+                             prof ? &_profile : nullptr);
+            if(prof)
+                _profile.recordNet(Profile::elapsed(t0, Profile::clock::now()), n);
+        }
+
+        /* Como computeBatch pero repartiendo las muestras entre los hilos del pool
+           de la red (o el pool por defecto) con robo de trabajo. Cada worker tiene
+           sus buffers y comparte los pesos. Cada muestra se calcula sola, por las
+           mismas rutinas que compute(), así que el resultado es idéntico bit a bit. */
+        void computeParallel(const T* in, T* out, size_t n)
+        {
+            if(_layer_list.empty() || n == 0)
+                return;
+            int l = 0;
+            for(auto &layer: this->_layer_list)
+                report(layer->code(), l++, layer->id());
+
+            ThreadPool &pool = _pool ? *_pool : defaultThreadPool();
+            const size_t workers = pool.size();
+            if(_worker_buff.size() < workers)
+                _worker_buff.resize(workers);
+            WorkStealingRanges ranges(n, workers, std::max<size_t>(1, n/(16*workers)));
+
+            const size_t si = _input_size;
+            const size_t so = _layer_list.back()->getOutputSize();
+            std::exception_ptr error;
+            std::mutex error_m;
+            pool.parallel_for(workers, 1, [&](size_t w0, size_t w1){
+                try
+                {
+                    for (size_t w = w0; w < w1; w++)
+                    {
+                        size_t b, e;
+                        while (ranges.next(w, b, e))
+                            for (size_t k = b; k < e; k++)
+                                detail::runBatch(_layer_list, in+k*si, out+k*so, 1, _worker_buff[w].buff,
+                                                 [this](OPCODE code, int i, const char* id){report(code, i, id);});
+                    }
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> lk(error_m);
+                    if(!error)
+                        error = std::current_exception();
+                }
+            });
+            if(error)
+                std::rethrow_exception(error);
+        }
+
         void operator()()
         {
             this->compute();
@@ -771,23 +2238,28 @@ class Net
         // Inicializar
         void init()
         {
+            kernels::initKernels();
             int n = 0;
             for(auto &layer: this->_layer_list)
             {
-                auto code = layer->code();
-                switch (_exlv)
-                {
-                case EXCEPLEVEL::THROW_ALL:
-                    if(code != OPCODE::OK)
-                        throw NetError(code, n, layer->id());
-                    break;
-                case EXCEPLEVEL::CERR:
-                    if(code != OPCODE::OK)
-                        std::cerr << code << " in layer " << n << " [type:" << layer->id() << "]" << std::endl;
-                    break;
-                }
+                report(layer->code(), n, layer->id());
                 ++n;
             }
+            if(_optlv == OPTLEVEL::FOLD)
+                foldLayers();
+            for(auto &layer: this->_layer_list)
+            {
+                auto wgptr = dynamic_cast<WGLayer<T>*>(layer.get());
+                if(wgptr && !wgptr->packed())
+                    wgptr->pack();
+                auto c2ptr = dynamic_cast<Conv2DLayer<T>*>(layer.get());
+                if(c2ptr && !c2ptr->packed())
+                    c2ptr->pack();
+                layer->setThreadPool(_pool);
+            }
+            fuseLayers();
+            planMemory();
+            resetProfile();
             _out = std::shared_ptr<T>{_layer_list.back()->_out};
             _output_size = _layer_list.back()->_size_o;
         }
@@ -811,7 +2283,11 @@ class Net
         uint16_t getInputSize() const {return _input_size;};
         uint16_t getOutputSize() const {return _output_size;};
 
+        // Tamaño en bytes de la arena de activaciones (tras init())
+        size_t activationBytes() const {return _arena_len*sizeof(T);}
+
         auto tail() const {return _layer_list.back();}
+        std::shared_ptr<GenericLayer<T>> layer(size_t k) const {return _layer_list.at(k);}
         uint16_t n_layers() const {return _layer_list.size();}
 
 };
@@ -877,12 +2353,21 @@ Net<T> loadNet(const char* toml_filename)
             outlayer = toml::find<std::uint16_t>(layer, "outputs");
             r1 = toml::find<std::string>(layer, "weights");
             r2 = toml::find<std::string>(layer, "bias");
+            // Almacenamiento opcional de los pesos: "fp16" o "bf16"
+            std::string format = toml::find_or(layer, "format", std::string("native"));
+            WeightFormat fmt = WeightFormat::NATIVE;
+            if (format == "fp16")
+                fmt = WeightFormat::FP16;
+            else if (format == "bf16")
+                fmt = WeightFormat::BF16;
+            else if (format != "native")
+                throw LoadError("Unknown weight format: " + format);
             if(net.n_layers() > 0)
             {
                 if (net.tail()->getOutputSize() == inlayer)
                 {
                     // Ok
-                    net.addWGLayer(outlayer, r1.c_str(), r2.c_str());
+                    net.addWGLayer(outlayer, r1.c_str(), r2.c_str(), fmt);
                 }
                 else
                 {
@@ -895,7 +2380,7 @@ Net<T> loadNet(const char* toml_filename)
                 if (net.getInputSize() == inlayer)
                 {
                     // Ok
-                    net.addWGLayer(outlayer, r1.c_str(), r2.c_str());
+                    net.addWGLayer(outlayer, r1.c_str(), r2.c_str(), fmt);
                 }
                 else
                 {
@@ -904,6 +2389,17 @@ Net<T> loadNet(const char* toml_filename)
                 }
             }
         }
+        else if  (type == "QWG") 
+        {
+            inlayer = toml::find<std::uint16_t>(layer, "inputs");
+            outlayer = toml::find<std::uint16_t>(layer, "outputs");
+            r1 = toml::find<std::string>(layer, "weights");
+            r2 = toml::find<std::string>(layer, "bias");
+            size_t width = net.n_layers() > 0 ? net.tail()->getOutputSize() : net.getInputSize();
+            if (width != inlayer)
+                throw LoadError("Inconsistent interlayer dimensions.");
+            net.addQuantWGLayer(outlayer, r1.c_str(), r2.c_str());
+        }
         else if (type == "ReLu")
         {
             lenlayer = toml::find<std::uint16_t>(layer, "len");
@@ -994,6 +2490,20 @@ Net<T> loadNet(const char* toml_filename)
                 }
             }
         } 
+        else if (type == "MaxPool" || type == "AvgPool")
+        {
+            // Ventana size x size con paso stride (por defecto size)
+            PoolParams params;
+            params.input = dim_t(toml::find<std::uint16_t>(layer, "cols"), toml::find<std::uint16_t>(layer, "rows"));
+            uint16_t size = toml::find<std::uint16_t>(layer, "size");
+            uint16_t stride = toml::find_or(layer, "stride", size);
+            params.size = dim_t(size, size);
+            params.stride = dim_t(stride, stride);
+            size_t width = net.n_layers() > 0 ? net.tail()->getOutputSize() : net.getInputSize();
+            if (width != params.inputLen() || params.outputLen() == 0)
+                throw LoadError("Inconsistent interlayer dimensions.");
+            net.addPoolLayer(params, type == "MaxPool" ? PoolMode::MAX : PoolMode::AVG);
+        }
         else 
         {
             // Error, capa no soportada
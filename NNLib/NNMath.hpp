@@ -0,0 +1,485 @@
+#ifndef __NN_NNMATH__
+#define __NN_NNMATH__
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include "NNUtils.hpp"
+#include "NNKernels.hpp"
+
+/*
+    Funciones trascendentes vectorizadas para las capas de activación.
+
+    Modos (ActMode):
+    - EXACT: std::exp del tipo T.
+    - FAST:  exp polinómica con reducción de rango, error relativo < 2 ulp en
+             float y en double. Es el modo por defecto. Versiones SSE4.2, AVX2
+             y AVX-512 elegidas con la misma tabla que la GEMV.
+    - LUT:   tablas con interpolación. Sigmoide: error absoluto < 3e-6.
+             Exponencial: error relativo < 3e-7.
+    En todos los modos una entrada NaN da NaN, como std::exp.
+*/
+
+namespace NN{
+namespace kernels{
+
+template<typename T> struct ExpConst;
+template<> struct ExpConst<float>
+{
+    static constexpr float round = 12582912.0f; // 1.5*2^23, redondeo al entero más cercano
+    static constexpr float lo = -87.3f, hi = 88.0f;
+    static constexpr float log2e = 1.44269504088896341f;
+    static constexpr float c1 = 0.693359375f, c2 = -2.12194440e-4f; // ln2 = c1 + c2
+};
+template<> struct ExpConst<double>
+{
+    static constexpr double round = 6755399441055744.0; // 1.5*2^52
+    static constexpr double lo = -708.0, hi = 709.0;
+    static constexpr double log2e = 1.4426950408889634074;
+    static constexpr double c1 = 0.693145751953125, c2 = 1.42860682030941723212e-6;
+};
+
+// 2^n para n entero dentro del rango normal de T.
+NN_ALWAYS_INLINE float pow2i(int32_t n)
+{
+    uint32_t bits = uint32_t(n+127) << 23;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+NN_ALWAYS_INLINE double pow2i(int64_t n)
+{
+    uint64_t bits = uint64_t(n+1023) << 52;
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+// exp(r) en |r| <= ln2/2.
+NN_ALWAYS_INLINE float expPolyReduced(float r)
+{
+    float y = 1.9875691500e-4f;
+    y = y*r + 1.3981999507e-3f;
+    y = y*r + 8.3334519073e-3f;
+    y = y*r + 4.1665795894e-2f;
+    y = y*r + 1.6666665459e-1f;
+    y = y*r + 5.0000001201e-1f;
+    return y*r*r + r + 1.0f;
+}
+NN_ALWAYS_INLINE double expPolyReduced(double r)
+{
+    // Taylor de grado 13
+    double y = 1.0/6227020800.0;
+    y = y*r + 1.0/479001600.0;
+    y = y*r + 1.0/39916800.0;
+    y = y*r + 1.0/3628800.0;
+    y = y*r + 1.0/362880.0;
+    y = y*r + 1.0/40320.0;
+    y = y*r + 1.0/5040.0;
+    y = y*r + 1.0/720.0;
+    y = y*r + 1.0/120.0;
+    y = y*r + 1.0/24.0;
+    y = y*r + 1.0/6.0;
+    y = y*r + 0.5;
+    return y*r*r + r + 1.0;
+}
+
+// exp(x) = 2^n * exp(r), con n = round(x/ln2) y r = x - n*ln2.
+template<typename T>
+NN_ALWAYS_INLINE T expFast(T x)
+{
+    using C = ExpConst<T>;
+    using I = typename std::conditional<sizeof(T) == 4, int32_t, int64_t>::type;
+    if (x != x)
+        return x; // NaN: el recorte no lo para y convertirlo a entero no está definido
+    x = std::min(std::max(x, C::lo), C::hi);
+    T fn = (x*C::log2e + C::round) - C::round;
+    T r = x - fn*C::c1 - fn*C::c2;
+    return expPolyReduced(r)*pow2i(I(fn));
+}
+
+template<typename T>
+void vexpRef(const T* in, T* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = expFast(in[i]);
+}
+
+#ifdef NN_X86_DISPATCH
+
+NN_TARGET("sse4.2") inline __m128 exp4(__m128 x)
+{
+    using C = ExpConst<float>;
+    // Con NaN min/max devuelven el segundo operando: x va detrás para que el NaN se propague
+    x = _mm_min_ps(_mm_set1_ps(C::hi), _mm_max_ps(_mm_set1_ps(C::lo), x));
+    __m128 fn = _mm_round_ps(_mm_mul_ps(x, _mm_set1_ps(C::log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(C::c1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(C::c2)));
+    __m128 y = _mm_set1_ps(1.9875691500e-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.3981999507e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(8.3334519073e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(4.1665795894e-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.6666665459e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(5.0000001201e-1f));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, r), r), r), _mm_set1_ps(1.0f));
+    __m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(fn), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(e));
+}
+
+NN_TARGET("avx2,fma") inline __m256 exp8(__m256 x)
+{
+    using C = ExpConst<float>;
+    x = _mm256_min_ps(_mm256_set1_ps(C::hi), _mm256_max_ps(_mm256_set1_ps(C::lo), x)); // NaN se propaga, ver exp4
+    __m256 fn = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(C::log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(fn, _mm256_set1_ps(C::c1), x);
+    r = _mm256_fnmadd_ps(fn, _mm256_set1_ps(C::c2), r);
+    __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.3981999507e-3f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(8.3334519073e-3f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(4.1665795894e-2f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.6666665459e-1f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(5.0000001201e-1f));
+    y = _mm256_add_ps(_mm256_fmadd_ps(_mm256_mul_ps(y, r), r, r), _mm256_set1_ps(1.0f));
+    __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(fn), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(e));
+}
+
+NN_TARGET("avx512f") inline __m512 exp16(__m512 x)
+{
+    using C = ExpConst<float>;
+    // Formas enmascaradas (todas las lanes): las sin máscara dan -Wmaybe-uninitialized en GCC 12
+    const __mmask16 all = 0xFFFF;
+    x = _mm512_maskz_min_ps(all, _mm512_set1_ps(C::hi), _mm512_maskz_max_ps(all, _mm512_set1_ps(C::lo), x)); // NaN se propaga, ver exp4
+    __m512 fn = _mm512_maskz_roundscale_ps(all, _mm512_mul_ps(x, _mm512_set1_ps(C::log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(fn, _mm512_set1_ps(C::c1), x);
+    r = _mm512_fnmadd_ps(fn, _mm512_set1_ps(C::c2), r);
+    __m512 y = _mm512_set1_ps(1.9875691500e-4f);
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(1.3981999507e-3f));
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(8.3334519073e-3f));
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(4.1665795894e-2f));
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(1.6666665459e-1f));
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(5.0000001201e-1f));
+    y = _mm512_add_ps(_mm512_fmadd_ps(_mm512_mul_ps(y, r), r, r), _mm512_set1_ps(1.0f));
+    __m512i e = _mm512_maskz_slli_epi32(all, _mm512_add_epi32(_mm512_maskz_cvtps_epi32(all, fn), _mm512_set1_epi32(127)), 23);
+    return _mm512_mul_ps(y, _mm512_castsi512_ps(e));
+}
+
+/* En double no hay conversión vectorial a int64 antes de AVX-512DQ: se usa
+   el truco de sumar 1.5*2^52, que deja n en los bits bajos de la mantisa. */
+
+NN_TARGET("sse4.2") inline __m128d exp2d(__m128d x)
+{
+    using C = ExpConst<double>;
+    x = _mm_min_pd(_mm_set1_pd(C::hi), _mm_max_pd(_mm_set1_pd(C::lo), x)); // NaN se propaga, ver exp4
+    __m128d t = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(C::log2e)), _mm_set1_pd(C::round));
+    __m128d fn = _mm_sub_pd(t, _mm_set1_pd(C::round));
+    __m128d r = _mm_sub_pd(x, _mm_mul_pd(fn, _mm_set1_pd(C::c1)));
+    r = _mm_sub_pd(r, _mm_mul_pd(fn, _mm_set1_pd(C::c2)));
+    __m128d y = _mm_set1_pd(1.0/6227020800.0);
+    const double c[] = {1.0/479001600.0, 1.0/39916800.0, 1.0/3628800.0, 1.0/362880.0, 1.0/40320.0,
+                        1.0/5040.0, 1.0/720.0, 1.0/120.0, 1.0/24.0, 1.0/6.0, 0.5};
+    for (double ci : c)
+        y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(ci));
+    y = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_mul_pd(y, r), r), r), _mm_set1_pd(1.0));
+    __m128i n = _mm_sub_epi64(_mm_castpd_si128(t), _mm_castpd_si128(_mm_set1_pd(C::round)));
+    __m128i e = _mm_slli_epi64(_mm_add_epi64(n, _mm_set1_epi64x(1023)), 52);
+    return _mm_mul_pd(y, _mm_castsi128_pd(e));
+}
+
+NN_TARGET("avx2,fma") inline __m256d exp4d(__m256d x)
+{
+    using C = ExpConst<double>;
+    x = _mm256_min_pd(_mm256_set1_pd(C::hi), _mm256_max_pd(_mm256_set1_pd(C::lo), x)); // NaN se propaga, ver exp4
+    __m256d t = _mm256_fmadd_pd(x, _mm256_set1_pd(C::log2e), _mm256_set1_pd(C::round));
+    __m256d fn = _mm256_sub_pd(t, _mm256_set1_pd(C::round));
+    __m256d r = _mm256_fnmadd_pd(fn, _mm256_set1_pd(C::c1), x);
+    r = _mm256_fnmadd_pd(fn, _mm256_set1_pd(C::c2), r);
+    __m256d y = _mm256_set1_pd(1.0/6227020800.0);
+    const double c[] = {1.0/479001600.0, 1.0/39916800.0, 1.0/3628800.0, 1.0/362880.0, 1.0/40320.0,
+                        1.0/5040.0, 1.0/720.0, 1.0/120.0, 1.0/24.0, 1.0/6.0, 0.5};
+    for (double ci : c)
+        y = _mm256_fmadd_pd(y, r, _mm256_set1_pd(ci));
+    y = _mm256_add_pd(_mm256_fmadd_pd(_mm256_mul_pd(y, r), r, r), _mm256_set1_pd(1.0));
+    __m256i n = _mm256_sub_epi64(_mm256_castpd_si256(t), _mm256_castpd_si256(_mm256_set1_pd(C::round)));
+    __m256i e = _mm256_slli_epi64(_mm256_add_epi64(n, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(y, _mm256_castsi256_pd(e));
+}
+
+NN_TARGET("avx512f") inline __m512d exp8d(__m512d x)
+{
+    using C = ExpConst<double>;
+    const __mmask8 all = 0xFF; // Como en exp16
+    x = _mm512_maskz_min_pd(all, _mm512_set1_pd(C::hi), _mm512_maskz_max_pd(all, _mm512_set1_pd(C::lo), x)); // NaN se propaga, ver exp4
+    __m512d t = _mm512_fmadd_pd(x, _mm512_set1_pd(C::log2e), _mm512_set1_pd(C::round));
+    __m512d fn = _mm512_sub_pd(t, _mm512_set1_pd(C::round));
+    __m512d r = _mm512_fnmadd_pd(fn, _mm512_set1_pd(C::c1), x);
+    r = _mm512_fnmadd_pd(fn, _mm512_set1_pd(C::c2), r);
+    __m512d y = _mm512_set1_pd(1.0/6227020800.0);
+    const double c[] = {1.0/479001600.0, 1.0/39916800.0, 1.0/3628800.0, 1.0/362880.0, 1.0/40320.0,
+                        1.0/5040.0, 1.0/720.0, 1.0/120.0, 1.0/24.0, 1.0/6.0, 0.5};
+    for (double ci : c)
+        y = _mm512_fmadd_pd(y, r, _mm512_set1_pd(ci));
+    y = _mm512_add_pd(_mm512_fmadd_pd(_mm512_mul_pd(y, r), r, r), _mm512_set1_pd(1.0));
+    __m512i n = _mm512_sub_epi64(_mm512_castpd_si512(t), _mm512_castpd_si512(_mm512_set1_pd(C::round)));
+    __m512i e = _mm512_maskz_slli_epi64(all, _mm512_add_epi64(n, _mm512_set1_epi64(1023)), 52);
+    return _mm512_mul_pd(y, _mm512_castsi512_pd(e));
+}
+
+/* Bucles vectoriales. Con sig se calcula 1/(1+exp(-x)), así la sigmoide
+   usa la misma exponencial. */
+
+NN_TARGET("sse4.2") inline void vexpSSE42(const float* in, float* out, size_t n, bool sig)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i+4 <= n; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(in+i);
+        if (sig)
+            _mm_storeu_ps(out+i, _mm_div_ps(one, _mm_add_ps(one, exp4(_mm_sub_ps(_mm_setzero_ps(), x)))));
+        else
+            _mm_storeu_ps(out+i, exp4(x));
+    }
+    for (; i < n; i++)
+        out[i] = sig ? 1.0f/(1.0f+expFast(-in[i])) : expFast(in[i]);
+}
+
+NN_TARGET("avx2,fma") inline void vexpAVX2(const float* in, float* out, size_t n, bool sig)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i+8 <= n; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(in+i);
+        if (sig)
+            _mm256_storeu_ps(out+i, _mm256_div_ps(one, _mm256_add_ps(one, exp8(_mm256_sub_ps(_mm256_setzero_ps(), x)))));
+        else
+            _mm256_storeu_ps(out+i, exp8(x));
+    }
+    for (; i < n; i++)
+        out[i] = sig ? 1.0f/(1.0f+expFast(-in[i])) : expFast(in[i]);
+}
+
+NN_TARGET("avx512f") inline void vexpAVX512(const float* in, float* out, size_t n, bool sig)
+{
+    const __m512 one = _mm512_set1_ps(1.0f);
+    for (size_t i = 0; i < n; i += 16)
+    {
+        const __mmask16 m = n-i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (n-i)) - 1);
+        __m512 x = _mm512_maskz_loadu_ps(m, in+i);
+        if (sig)
+            _mm512_mask_storeu_ps(out+i, m, _mm512_div_ps(one, _mm512_add_ps(one, exp16(_mm512_sub_ps(_mm512_setzero_ps(), x)))));
+        else
+            _mm512_mask_storeu_ps(out+i, m, exp16(x));
+    }
+}
+
+NN_TARGET("sse4.2") inline void vexpSSE42(const double* in, double* out, size_t n, bool sig)
+{
+    const __m128d one = _mm_set1_pd(1.0);
+    size_t i = 0;
+    for (; i+2 <= n; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(in+i);
+        if (sig)
+            _mm_storeu_pd(out+i, _mm_div_pd(one, _mm_add_pd(one, exp2d(_mm_sub_pd(_mm_setzero_pd(), x)))));
+        else
+            _mm_storeu_pd(out+i, exp2d(x));
+    }
+    for (; i < n; i++)
+        out[i] = sig ? 1.0/(1.0+expFast(-in[i])) : expFast(in[i]);
+}
+
+NN_TARGET("avx2,fma") inline void vexpAVX2(const double* in, double* out, size_t n, bool sig)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i+4 <= n; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(in+i);
+        if (sig)
+            _mm256_storeu_pd(out+i, _mm256_div_pd(one, _mm256_add_pd(one, exp4d(_mm256_sub_pd(_mm256_setzero_pd(), x)))));
+        else
+            _mm256_storeu_pd(out+i, exp4d(x));
+    }
+    for (; i < n; i++)
+        out[i] = sig ? 1.0/(1.0+expFast(-in[i])) : expFast(in[i]);
+}
+
+NN_TARGET("avx512f") inline void vexpAVX512(const double* in, double* out, size_t n, bool sig)
+{
+    const __m512d one = _mm512_set1_pd(1.0);
+    for (size_t i = 0; i < n; i += 8)
+    {
+        const __mmask8 m = n-i >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (n-i)) - 1);
+        __m512d x = _mm512_maskz_loadu_pd(m, in+i);
+        if (sig)
+            _mm512_mask_storeu_pd(out+i, m, _mm512_div_pd(one, _mm512_add_pd(one, exp8d(_mm512_sub_pd(_mm512_setzero_pd(), x)))));
+        else
+            _mm512_mask_storeu_pd(out+i, m, exp8d(x));
+    }
+}
+
+#endif
+
+// exp(x), o 1/(1+exp(-x)) si sig, con la ISA activa. Admite in == out.
+template<typename T>
+void vexp(const T* in, T* out, size_t n, bool sig = false)
+{
+#ifdef NN_X86_DISPATCH
+    if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value)
+    {
+        switch (kernelTable<T>().isa)
+        {
+        case ISA::AVX512: vexpAVX512(in, out, n, sig); return;
+        case ISA::AVX2:   vexpAVX2(in, out, n, sig);   return;
+        case ISA::SSE42:  vexpSSE42(in, out, n, sig);  return;
+        default: break;
+        }
+    }
+#endif
+    if (sig)
+        for (size_t i = 0; i < n; i++)
+            out[i] = T(1)/(T(1)+expFast(-in[i]));
+    else
+        vexpRef(in, out, n);
+}
+
+/* Tablas. exp: 2^(j/64) para j en [0,64). Sigmoide: muestras cada 1/128 en
+   [-16,16], fuera de ese rango se satura (error < 1.2e-7). Con paso 1/64 la
+   interpolación lineal ya da 2.9e-6 y en float se pasaba de 3e-6. */
+#define NN_LUT_SIGMOID_RANGE 16
+#define NN_LUT_SIGMOID_STEPS 128
+
+template<typename T>
+const T* exp2Table()
+{
+    static const std::vector<T> table = []{
+        std::vector<T> t(64);
+        for (size_t j = 0; j < 64; j++)
+            t[j] = std::exp2(T(j)/T(64));
+        return t;
+    }();
+    return table.data();
+}
+
+template<typename T>
+const T* sigmoidTable()
+{
+    constexpr size_t len = 2*NN_LUT_SIGMOID_RANGE*NN_LUT_SIGMOID_STEPS+1;
+    static const std::vector<T> table = []{
+        std::vector<T> t(len+1);
+        for (size_t j = 0; j < len; j++)
+        {
+            double x = double(j)/NN_LUT_SIGMOID_STEPS - NN_LUT_SIGMOID_RANGE;
+            t[j] = T(1.0/(1.0+std::exp(-x)));
+        }
+        t[len] = t[len-1]; // Para interpolar en el extremo
+        return t;
+    }();
+    return table.data();
+}
+
+// exp por tabla: e^x = 2^(k/64) * e^f, con k = floor(64*x*log2e) y f en [0, ln2/64).
+// e^f con Taylor de grado 3 (error 6e-10): con grado 2 el redondeo en float pasaba de 3e-7.
+template<typename T>
+NN_ALWAYS_INLINE T expLUT(T x, const T* tab)
+{
+    using C = ExpConst<T>;
+    using I = typename std::conditional<sizeof(T) == 4, int32_t, int64_t>::type;
+    if (x != x)
+        return x; // NaN, como en expFast
+    x = std::min(std::max(x, C::lo), C::hi);
+    T k = std::floor(x*C::log2e*T(64));
+    T f = x - k*(C::c1/T(64)) - k*(C::c2/T(64));
+    I ki = I(k);
+    T p = T(1) + f*(T(1) + f*(T(0.5) + f*T(1.0/6)));
+    return pow2i(I(ki >> 6))*tab[ki & 63]*p;
+}
+
+template<typename T>
+NN_ALWAYS_INLINE T sigmoidLUT(T x, const T* tab)
+{
+    if (x != x)
+        return x; // NaN: daría un índice fuera de la tabla
+    T t = (std::min(std::max(x, T(-NN_LUT_SIGMOID_RANGE)), T(NN_LUT_SIGMOID_RANGE)) + T(NN_LUT_SIGMOID_RANGE))*T(NN_LUT_SIGMOID_STEPS);
+    size_t j = size_t(t);
+    T f = t - T(j);
+    return tab[j] + f*(tab[j+1]-tab[j]);
+}
+
+// out = exp(in) según el modo. Admite in == out.
+template<typename T>
+void vexp(const T* in, T* out, size_t n, ActMode mode)
+{
+    switch (mode)
+    {
+    case ActMode::EXACT:
+        for (size_t i = 0; i < n; i++)
+            out[i] = std::exp(in[i]);
+        break;
+    case ActMode::LUT:
+    {
+        const T* tab = exp2Table<T>();
+        for (size_t i = 0; i < n; i++)
+            out[i] = expLUT(in[i], tab);
+        break;
+    }
+    default:
+        vexp(in, out, n, false);
+        break;
+    }
+}
+
+// out = 1/(1+exp(-in)). Admite in == out.
+template<typename T>
+void sigmoid(const T* in, T* out, size_t n, ActMode mode = ActMode::FAST)
+{
+    switch (mode)
+    {
+    case ActMode::EXACT:
+        for (size_t i = 0; i < n; i++)
+            out[i] = T(1)/(T(1)+std::exp(-in[i]));
+        break;
+    case ActMode::LUT:
+    {
+        const T* tab = sigmoidTable<T>();
+        for (size_t i = 0; i < n; i++)
+            out[i] = sigmoidLUT(in[i], tab);
+        break;
+    }
+    default:
+        vexp(in, out, n, true);
+        break;
+    }
+}
+
+/* Softmax estable: se resta el máximo antes de la exponencial para que no
+   desborde. Devuelve false si la suma no es positiva (p.ej. entradas NaN).
+   Admite in == out. */
+template<typename T>
+bool softmax(const T* in, T* out, size_t n, ActMode mode = ActMode::FAST)
+{
+    T max = in[0];
+    for (size_t i = 1; i < n; i++)
+        max = std::max(max, in[i]);
+    for (size_t i = 0; i < n; i++)
+        out[i] = in[i] - max;
+    vexp(out, out, n, mode);
+    T eacc = 0;
+    for (size_t i = 0; i < n; i++)
+        eacc += out[i];
+    if (!(eacc > 0))
+        return false;
+    const T inv = T(1)/eacc;
+    for (size_t i = 0; i < n; i++)
+        out[i] *= inv;
+    return true;
+}
+
+}
+}
+
+#endif
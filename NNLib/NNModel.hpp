@@ -0,0 +1,102 @@
+#ifndef __NN_NNMODEL__
+#define __NN_NNMODEL__
+
+#include <memory>
+#include <vector>
+#include "NNLib.hpp"
+
+/*
+    Pesos inmutables compartidos entre hilos y activaciones por hilo.
+
+        auto model = NN::loadModel<float>("./data/nn1.toml"); // shared_ptr<const Model>
+        NN::ExecutionContext<float> ctx(model);               // uno por hilo
+
+    Model guarda una copia inicializada de las capas de una Net y solo usa sus
+    métodos const (computeBatch), así que no tiene estado mutable. Cada
+    ExecutionContext tiene su entrada, su salida y los buffers intermedios.
+*/
+
+namespace NN{
+
+template<typename T>
+class Model
+{
+    private:
+        template<typename> friend class ExecutionContext;
+        std::vector<std::shared_ptr<const GenericLayer<T>>> _layers;
+        uint16_t _input_size, _output_size;
+        EXCEPLEVEL _exlv;
+
+        void run(const T* in, T* out, size_t n, std::vector<T> (&buff)[2]) const
+        {
+            if(n == 0)
+                return;
+            detail::runBatch(_layers, in, out, n, buff,
+                             [this](OPCODE code, int i, const char* id){detail::reportError(_exlv, code, i, id);});
+        }
+    public:
+        Model() = delete;
+        // Inicializa net y se queda con sus capas: pasar una copia o std::move(net).
+        explicit Model(Net<T> net) : _input_size(net._input_size), _exlv(net._exlv)
+        {
+            if(net._layer_list.empty())
+                throw NetError(OPCODE::BUILD_ERROR_0);
+            net.init();
+            _output_size = net._output_size;
+            _layers.assign(net._layer_list.begin(), net._layer_list.end());
+        }
+        Model(const Model<T>&) = delete;
+        Model<T>& operator=(const Model<T>&) = delete;
+
+        static std::shared_ptr<const Model<T>> create(Net<T> net)
+        {
+            return std::make_shared<const Model<T>>(std::move(net));
+        }
+
+        uint16_t getInputSize() const {return _input_size;}
+        uint16_t getOutputSize() const {return _output_size;}
+        uint16_t n_layers() const {return _layers.size();}
+        std::shared_ptr<const GenericLayer<T>> layer(size_t k) const {return _layers.at(k);}
+};
+
+template<typename T = float>
+class ExecutionContext
+{
+    private:
+        std::shared_ptr<const Model<T>> _model;
+        std::vector<T> _in, _out;
+        std::vector<T> _buff[2]; // Buffers ping-pong entre capas
+    public:
+        ExecutionContext() = delete;
+        explicit ExecutionContext(std::shared_ptr<const Model<T>> model) : _model(std::move(model))
+        {
+            _in.resize(_model->getInputSize());
+            _out.resize(_model->getOutputSize());
+        }
+
+        // Computar
+        void compute() {_model->run(_in.data(), _out.data(), 1, _buff);}
+        void operator()() {compute();}
+        void computeBatch(const T* in, T* out, size_t n) {_model->run(in, out, n, _buff);}
+
+        // Copiar entrada/salida
+        void copy2input(const T* origin) {std::copy(origin, origin+_in.size(), _in.begin());}
+        void copyout(T* dest) const {std::copy(_out.begin(), _out.end(), dest);}
+
+        T* getInput() {return _in.data();}
+        const T* getOutput() const {return _out.data();}
+        uint16_t getInputSize() const {return _in.size();}
+        uint16_t getOutputSize() const {return _out.size();}
+
+        const std::shared_ptr<const Model<T>>& model() const {return _model;}
+};
+
+template<typename T>
+std::shared_ptr<const Model<T>> loadModel(const char* toml_filename)
+{
+    return Model<T>::create(loadNet<T>(toml_filename));
+}
+
+}
+
+#endif
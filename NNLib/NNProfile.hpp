@@ -0,0 +1,190 @@
+#ifndef __NN_NNPROFILE__
+#define __NN_NNPROFILE__
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <limits>
+#include <iostream>
+#include <iomanip>
+
+/*
+    Perfilado por capa de Net (Net::setProfiling, Net::profile()).
+
+    Por cada capa se guardan llamadas, tiempo total, mínimo, máximo y un
+    histograma logarítmico (8 cubos por octava, error < 7 %) del que salen los
+    percentiles sin guardar las muestras: la memoria es fija y registrar una
+    llamada son dos lecturas del reloj y unas sumas. Con el perfilado apagado
+    en tiempo de ejecución queda una rama por pasada; con NN_PROFILE 0 el
+    código desaparece.
+*/
+
+// 0: elimina el perfilado en compilación
+#ifndef NN_PROFILE
+#define NN_PROFILE 1
+#endif
+
+namespace NN{
+
+class LayerStats
+{
+    private:
+        static constexpr unsigned SUB = 8; // Cubos por octava
+        static constexpr unsigned BUCKETS = (64-2)*SUB;
+        uint64_t _count = 0, _total = 0;
+        uint64_t _min = std::numeric_limits<uint64_t>::max(), _max = 0;
+        std::vector<uint64_t> _hist = std::vector<uint64_t>(BUCKETS);
+
+        static unsigned log2floor(uint64_t v)
+        {
+#if defined(__GNUC__)
+            return 63 - __builtin_clzll(v);
+#else
+            unsigned k = 0;
+            while (v >>= 1)
+                k++;
+            return k;
+#endif
+        }
+        // Cubo de ns: exacto por debajo de SUB, luego SUB cubos por potencia de 2
+        static unsigned bucket(uint64_t ns)
+        {
+            if (ns < SUB)
+                return unsigned(ns);
+            const unsigned k = log2floor(ns);
+            return (k-2)*SUB + unsigned((ns >> (k-3)) & (SUB-1));
+        }
+        static double lower(unsigned b)
+        {
+            if (b < SUB)
+                return b;
+            return std::ldexp(double(SUB + b%SUB), int(b/SUB) - 1);
+        }
+    public:
+        /* n muestras medidas juntas (un bloque de computeBatch) cuentan como n
+           llamadas de ns/n: así compute() y computeBatch() dan tiempos por
+           muestra. min y max redondean hacia fuera para acotar la media. */
+        void record(uint64_t ns, uint64_t n = 1)
+        {
+            if (!n)
+                return;
+            const uint64_t lo = ns/n, hi = (ns+n-1)/n;
+            _count += n;
+            _total += ns;
+            _min = lo < _min ? lo : _min;
+            _max = hi > _max ? hi : _max;
+            _hist[bucket(lo)] += n;
+        }
+        void reset() {*this = LayerStats();}
+
+        uint64_t count() const {return _count;}
+        uint64_t total() const {return _total;} // ns
+        uint64_t min() const {return _count ? _min : 0;}
+        uint64_t max() const {return _max;}
+        double mean() const {return _count ? double(_total)/_count : 0;}
+
+        // Percentil p (0-1) aproximado: centro del cubo, acotado por min y max
+        double percentile(double p) const
+        {
+            if (!_count)
+                return 0;
+            const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(p*_count)));
+            uint64_t acc = 0;
+            for (unsigned b = 0; b < BUCKETS; b++)
+            {
+                acc += _hist[b];
+                if (acc >= rank)
+                {
+                    const double mid = 0.5*(lower(b) + lower(b+1));
+                    return std::min<double>(std::max<double>(mid, _min), _max);
+                }
+            }
+            return double(_max);
+        }
+};
+
+class Profile
+{
+    private:
+        std::vector<std::string> _ids;
+        std::vector<bool> _fused;
+        std::vector<LayerStats> _layers;
+        LayerStats _net; // Pasada completa
+    public:
+        using clock = std::chrono::steady_clock;
+
+        void setLayers(std::vector<std::string> ids, std::vector<bool> fused)
+        {
+            _ids = std::move(ids);
+            _fused = std::move(fused);
+            _layers.assign(_ids.size(), LayerStats());
+            _net.reset();
+        }
+        void reset()
+        {
+            for (auto &l : _layers)
+                l.reset();
+            _net.reset();
+        }
+
+        static uint64_t elapsed(clock::time_point t0, clock::time_point t1)
+        {
+            return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1-t0).count());
+        }
+        void record(size_t layer, uint64_t ns, uint64_t samples = 1) {_layers[layer].record(ns, samples);}
+        void recordNet(uint64_t ns, uint64_t samples = 1) {_net.record(ns, samples);}
+
+        size_t size() const {return _layers.size();}
+        const LayerStats& operator[](size_t k) const {return _layers.at(k);}
+        const std::string& id(size_t k) const {return _ids.at(k);}
+        bool fused(size_t k) const {return _fused.at(k);}
+        const LayerStats& net() const {return _net;}
+
+        // Tabla por capa, tiempos en µs; % sobre la suma de todas las capas
+        void print(std::ostream &os) const
+        {
+            uint64_t sum = 0;
+            for (auto &l : _layers)
+                sum += l.total();
+            const auto flags = os.flags();
+            const auto prec = os.precision();
+            os << std::right << std::setw(4) << "#" << "  " << std::left << std::setw(14) << "capa" << std::right
+               << std::setw(10) << "llamadas" << std::setw(12) << "total ms" << std::setw(10) << "min µs"
+               << std::setw(10) << "media µs" << std::setw(10) << "p99 µs" << std::setw(10) << "max µs" << std::setw(8) << "%" << std::endl;
+            os << std::fixed;
+            auto row = [&](const LayerStats &l){
+                os << std::setw(10) << l.count() << std::setprecision(3) << std::setw(12) << l.total()*1e-6
+                   << std::setw(10) << l.min()*1e-3 << std::setw(10) << l.mean()*1e-3
+                   << std::setw(10) << l.percentile(0.99)*1e-3 << std::setw(10) << l.max()*1e-3;
+            };
+            for (size_t k = 0; k < _layers.size(); k++)
+            {
+                os << std::setw(4) << k << "  " << std::left << std::setw(14) << _ids[k] << std::right;
+                if (_fused[k])
+                {
+                    os << "  (fusionada con la anterior)" << std::endl;
+                    continue;
+                }
+                row(_layers[k]);
+                os << std::setprecision(1) << std::setw(8) << (sum ? 100.0*_layers[k].total()/sum : 0.0) << std::endl;
+            }
+            os << std::setw(4) << "" << "  " << std::left << std::setw(14) << "Net" << std::right;
+            row(_net);
+            os << std::endl;
+            os.flags(flags);
+            os.precision(prec);
+        }
+};
+
+inline std::ostream& operator<<(std::ostream &os, const Profile &p)
+{
+    p.print(os);
+    return os;
+}
+
+}
+
+#endif
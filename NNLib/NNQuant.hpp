@@ -0,0 +1,255 @@
+#ifndef __NN_NNQUANT__
+#define __NN_NNQUANT__
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "NNKernels.hpp"
+
+/*
+    Núcleos INT8 de QuantWGLayer.
+
+    Pesos: int8 por filas con escala y punto cero propios de cada fila,
+        W[i][j] ~ s_i*(Wq[i][j] - zw_i)
+    Entradas: se cuantizan en cada pasada a 7 bits sin signo [0, 127],
+        x[j] ~ s_x*(xq[j] - zx)
+    Con 7 bits el par de productos u8*s8 que suma maddubs nunca satura en
+    int16, así AVX2 y VNNI dan exactamente el mismo resultado entero:
+        y_i = s_i*s_x*(sum_j Wq*xq - zx*sum_j Wq - zw_i*sum_j xq + cols*zw_i*zx) + B_i
+
+    Las filas de Wq y el vector xq se rellenan con ceros hasta un múltiplo de
+    64 bytes (qStride), así los núcleos no tienen cola.
+*/
+
+namespace NN{
+namespace kernels{
+
+constexpr int32_t QX_MAX = 127; // Entradas en 7 bits
+
+inline size_t qStride(size_t cols) {return (cols+63)/64*64;}
+
+/* Cuantiza W[rows][cols] por filas en Wq[rows][qStride(cols)].
+   Rellena scale, zero y rowsum (suma de Wq de cada fila). */
+template<typename T>
+void quantizeRows(const T* W, size_t rows, size_t cols, int8_t* Wq, T* scale, int32_t* zero, int32_t* rowsum)
+{
+    const size_t stride = qStride(cols);
+    for (size_t i = 0; i < rows; i++)
+    {
+        const T* w = W + i*cols;
+        T lo = std::min<T>(0, *std::min_element(w, w+cols));
+        T hi = std::max<T>(0, *std::max_element(w, w+cols));
+        T s = (hi > lo) ? (hi-lo)/T(255) : T(1);
+        int32_t z = std::max(-128, std::min(127, int32_t(std::lround(-128 - lo/s))));
+        int8_t* q = Wq + i*stride;
+        int32_t sum = 0;
+        for (size_t j = 0; j < cols; j++)
+        {
+            int32_t v = std::max(-128, std::min(127, int32_t(std::lround(w[j]/s)) + z));
+            q[j] = int8_t(v);
+            sum += v;
+        }
+        std::fill(q+cols, q+stride, int8_t(0));
+        scale[i] = s;
+        zero[i] = z;
+        rowsum[i] = sum;
+    }
+}
+
+/* Cuantiza una entrada de cols valores en xq[qStride(cols)].
+   Devuelve la suma de xq; scale y zero reciben s_x y zx. */
+template<typename T>
+int32_t quantizeInput(const T* x, size_t cols, uint8_t* xq, T &scale, int32_t &zero)
+{
+    T lo = 0, hi = 0;
+    for (size_t j = 0; j < cols; j++)
+    {
+        lo = std::min(lo, x[j]);
+        hi = std::max(hi, x[j]);
+    }
+    const T s = (hi > lo) ? (hi-lo)/T(QX_MAX) : T(1);
+    const int32_t z = std::max(0, std::min(QX_MAX, int32_t(std::lround(-lo/s))));
+    const T inv = T(1)/s;
+    int32_t sum = 0;
+    for (size_t j = 0; j < cols; j++)
+    {
+        int32_t v = std::max(0, std::min(QX_MAX, int32_t(std::lround(x[j]*inv)) + z));
+        xq[j] = uint8_t(v);
+        sum += v;
+    }
+    std::fill(xq+cols, xq+qStride(cols), uint8_t(0));
+    scale = s;
+    zero = z;
+    return sum;
+}
+
+// acc[i] = sum_j Wq[i][j]*xq[j] sobre stride columnas. Referencia escalar.
+inline void qgemvRef(const int8_t* Wq, const uint8_t* xq, int32_t* acc, size_t rows, size_t stride)
+{
+    for (size_t i = 0; i < rows; i++)
+    {
+        const int8_t* w = Wq + i*stride;
+        int32_t a = 0;
+        for (size_t j = 0; j < stride; j++)
+            a += int32_t(w[j])*int32_t(xq[j]);
+        acc[i] = a;
+    }
+}
+
+#ifdef NN_X86_DISPATCH
+
+NN_TARGET("avx2") inline int32_t hsum32(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+// Como hsum(__m512) de NNKernels: _mm512_reduce_add_epi32 da -Wmaybe-uninitialized en GCC 12
+NN_TARGET("avx512f,avx2") inline int32_t hsum32(__m512i v)
+{
+    return hsum32(_mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xF, v, 0), _mm512_maskz_extracti64x4_epi64(0xF, v, 1)));
+}
+
+NN_TARGET("avx2") inline __m256i load256(const void* p)
+{
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+// maddubs (u8*s8 -> pares en int16) + madd con unos (-> int32)
+NN_TARGET("avx2") inline __m256i qdotAVX2(__m256i acc, __m256i x, const int8_t* w)
+{
+    const __m256i p = _mm256_maddubs_epi16(x, load256(w));
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(p, _mm256_set1_epi16(1)));
+}
+
+NN_TARGET("avx2") inline void qgemvAVX2(const int8_t* Wq, const uint8_t* xq, int32_t* acc, size_t rows, size_t stride)
+{
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const int8_t* w = Wq + i*stride;
+        __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+        for (size_t j = 0; j < stride; j += 32)
+        {
+            const __m256i x = load256(xq+j);
+            a0 = qdotAVX2(a0, x, w+j);
+            a1 = qdotAVX2(a1, x, w+stride+j);
+            a2 = qdotAVX2(a2, x, w+2*stride+j);
+            a3 = qdotAVX2(a3, x, w+3*stride+j);
+        }
+        acc[i] = hsum32(a0);
+        acc[i+1] = hsum32(a1);
+        acc[i+2] = hsum32(a2);
+        acc[i+3] = hsum32(a3);
+    }
+    for (; i < rows; i++)
+    {
+        const int8_t* w = Wq + i*stride;
+        __m256i a0 = _mm256_setzero_si256();
+        for (size_t j = 0; j < stride; j += 32)
+            a0 = qdotAVX2(a0, load256(xq+j), w+j);
+        acc[i] = hsum32(a0);
+    }
+}
+
+// AVX-VNNI: vpdpbusd sobre 256 bits acumula directamente en int32
+NN_TARGET("avx2,avxvnni") inline void qgemvAVXVNNI(const int8_t* Wq, const uint8_t* xq, int32_t* acc, size_t rows, size_t stride)
+{
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const int8_t* w = Wq + i*stride;
+        __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+        for (size_t j = 0; j < stride; j += 32)
+        {
+            const __m256i x = load256(xq+j);
+            a0 = _mm256_dpbusd_avx_epi32(a0, x, load256(w+j));
+            a1 = _mm256_dpbusd_avx_epi32(a1, x, load256(w+stride+j));
+            a2 = _mm256_dpbusd_avx_epi32(a2, x, load256(w+2*stride+j));
+            a3 = _mm256_dpbusd_avx_epi32(a3, x, load256(w+3*stride+j));
+        }
+        acc[i] = hsum32(a0);
+        acc[i+1] = hsum32(a1);
+        acc[i+2] = hsum32(a2);
+        acc[i+3] = hsum32(a3);
+    }
+    for (; i < rows; i++)
+    {
+        const int8_t* w = Wq + i*stride;
+        __m256i a0 = _mm256_setzero_si256();
+        for (size_t j = 0; j < stride; j += 32)
+            a0 = _mm256_dpbusd_avx_epi32(a0, load256(xq+j), load256(w+j));
+        acc[i] = hsum32(a0);
+    }
+}
+
+// AVX-512 VNNI: 64 productos por instrucción
+NN_TARGET("avx512f,avx512vnni") inline void qgemvAVX512VNNI(const int8_t* Wq, const uint8_t* xq, int32_t* acc, size_t rows, size_t stride)
+{
+    size_t i = 0;
+    for (; i+4 <= rows; i += 4)
+    {
+        const int8_t* w = Wq + i*stride;
+        __m512i a0 = _mm512_setzero_si512(), a1 = a0, a2 = a0, a3 = a0;
+        for (size_t j = 0; j < stride; j += 64)
+        {
+            const __m512i x = _mm512_load_si512(xq+j);
+            a0 = _mm512_dpbusd_epi32(a0, x, _mm512_load_si512(w+j));
+            a1 = _mm512_dpbusd_epi32(a1, x, _mm512_load_si512(w+stride+j));
+            a2 = _mm512_dpbusd_epi32(a2, x, _mm512_load_si512(w+2*stride+j));
+            a3 = _mm512_dpbusd_epi32(a3, x, _mm512_load_si512(w+3*stride+j));
+        }
+        acc[i] = hsum32(a0);
+        acc[i+1] = hsum32(a1);
+        acc[i+2] = hsum32(a2);
+        acc[i+3] = hsum32(a3);
+    }
+    for (; i < rows; i++)
+    {
+        const int8_t* w = Wq + i*stride;
+        __m512i a0 = _mm512_setzero_si512();
+        for (size_t j = 0; j < stride; j += 64)
+            a0 = _mm512_dpbusd_epi32(a0, _mm512_load_si512(xq+j), _mm512_load_si512(w+j));
+        acc[i] = hsum32(a0);
+    }
+}
+
+#endif
+
+using QGemvFn = void (*)(const int8_t*, const uint8_t*, int32_t*, size_t, size_t);
+
+/* Núcleo INT8 según el ISA activo (setISA lo limita también aquí) y las
+   extensiones VNNI disponibles. */
+inline QGemvFn qgemvKernel()
+{
+#ifdef NN_X86_DISPATCH
+    static const bool vnni512 = __builtin_cpu_supports("avx512vnni");
+    static const bool vnni256 = __builtin_cpu_supports("avxvnni");
+    switch (activeISA())
+    {
+    case ISA::AVX512:
+        if (vnni512)
+            return qgemvAVX512VNNI;
+        if (vnni256)
+            return qgemvAVXVNNI;
+        return qgemvAVX2;
+    case ISA::AVX2:
+        return vnni256 ? qgemvAVXVNNI : qgemvAVX2;
+    default:
+        break;
+    }
+#endif
+    return qgemvRef;
+}
+
+inline void qgemv(const int8_t* Wq, const uint8_t* xq, int32_t* acc, size_t rows, size_t stride)
+{
+    qgemvKernel()(Wq, xq, acc, rows, stride);
+}
+
+}
+}
+
+#endif
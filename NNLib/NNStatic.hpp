@@ -0,0 +1,211 @@
+#ifndef __NN_NNSTATIC__
+#define __NN_NNSTATIC__
+
+#include <array>
+#include <tuple>
+#include <cstdio>
+#include <algorithm>
+#include <type_traits>
+#include "NNUtils.hpp"
+#include "NNKernels.hpp"
+#include "NNMath.hpp"
+
+/*
+    Red con la topología fijada en tiempo de compilación.
+
+        NN::StaticNet<float, NN::Norm<4>, NN::WG<4,8>, NN::ReLu<8>, NN::WG<8,3>, NN::SoftMax<3>> net;
+
+    Todos los datos viven en std::array dentro del objeto (sin heap) y la
+    pasada hacia delante se despliega en tiempo de compilación, sin llamadas
+    virtuales. Las operaciones son las mismas funciones de NNKernels/NNMath que
+    usan las capas de Net.
+*/
+
+namespace NN{
+
+namespace detail{
+
+template<typename T>
+OPCODE loadCSV(const char* filename, T* dest, size_t len)
+{
+    return parseStatus(parseCSV(filename, dest, len));
+}
+
+}
+
+// Normalización (x-M)/S
+template<size_t N>
+struct Norm
+{
+    static constexpr size_t inputs = N, outputs = N;
+    template<typename T>
+    struct Layer
+    {
+        std::array<T, N> means, sd;
+        OPCODE compute(const T* in, T* out) const
+        {
+            return kernels::normalize(in, out, means.data(), sd.data(), N) ? OPCODE::OK : OPCODE::OP_ERROR_2;
+        }
+        OPCODE load(const char* file_m, const char* file_sd)
+        {
+            OPCODE code = detail::loadCSV(file_m, means.data(), N);
+            return code != OPCODE::OK ? code : detail::loadCSV(file_sd, sd.data(), N);
+        }
+        void set(const T* m_first, const T* sd_first)
+        {
+            std::copy(m_first, m_first+N, means.begin());
+            std::copy(sd_first, sd_first+N, sd.begin());
+        }
+    };
+};
+
+// Pesos + sesgo, W[O][I] por filas
+template<size_t I, size_t O>
+struct WG
+{
+    static constexpr size_t inputs = I, outputs = O;
+    template<typename T>
+    struct Layer
+    {
+        std::array<T, I*O> weights;
+        std::array<T, O> bias;
+        OPCODE compute(const T* in, T* out) const
+        {
+            // Versión de referencia: con tamaños constantes el compilador la despliega y vectoriza.
+            kernels::gemvRef(weights.data(), bias.data(), in, out, O, I);
+            return OPCODE::OK;
+        }
+        OPCODE load(const char* file_w, const char* file_b)
+        {
+            OPCODE code = detail::loadCSV(file_w, weights.data(), I*O);
+            return code != OPCODE::OK ? code : detail::loadCSV(file_b, bias.data(), O);
+        }
+        void set(const T* w_first, const T* b_first)
+        {
+            std::copy(w_first, w_first+I*O, weights.begin());
+            std::copy(b_first, b_first+O, bias.begin());
+        }
+    };
+};
+
+template<size_t N>
+struct ReLu
+{
+    static constexpr size_t inputs = N, outputs = N;
+    template<typename T>
+    struct Layer
+    {
+        OPCODE compute(const T* in, T* out) const
+        {
+            kernels::relu(in, out, N);
+            return OPCODE::OK;
+        }
+    };
+};
+
+template<size_t N, ActMode M = ActMode::FAST>
+struct Sigmoid
+{
+    static constexpr size_t inputs = N, outputs = N;
+    template<typename T>
+    struct Layer
+    {
+        OPCODE compute(const T* in, T* out) const
+        {
+            kernels::sigmoid(in, out, N, M);
+            return OPCODE::OK;
+        }
+    };
+};
+
+template<size_t N, ActMode M = ActMode::FAST>
+struct SoftMax
+{
+    static constexpr size_t inputs = N, outputs = N;
+    template<typename T>
+    struct Layer
+    {
+        OPCODE compute(const T* in, T* out) const
+        {
+            return kernels::softmax(in, out, N, M) ? OPCODE::OK : OPCODE::OP_ERROR_2;
+        }
+    };
+};
+
+template<typename T, typename... Layers>
+class StaticNet
+{
+    static_assert(std::is_floating_point<T>::value, "A StaticNet class can only be instantiated with floating point types.");
+    static_assert(sizeof...(Layers) > 0, "A StaticNet needs at least one layer.");
+
+    private:
+        static constexpr size_t _n = sizeof...(Layers);
+        static constexpr size_t _sizes_i[_n] = {Layers::inputs...};
+        static constexpr size_t _sizes_o[_n] = {Layers::outputs...};
+
+        static constexpr bool chained()
+        {
+            for (size_t k = 1; k < _n; k++)
+                if (_sizes_i[k] != _sizes_o[k-1])
+                    return false;
+            return true;
+        }
+        static constexpr size_t maxWidth()
+        {
+            size_t w = 1;
+            for (size_t k = 0; k+1 < _n; k++)
+                w = std::max(w, _sizes_o[k]);
+            return w;
+        }
+        static_assert(chained(), "Inconsistent interlayer dimensions.");
+
+    public:
+        static constexpr size_t inputs = _sizes_i[0];
+        static constexpr size_t outputs = _sizes_o[_n-1];
+
+    private:
+        std::tuple<typename Layers::template Layer<T>...> _layers;
+        std::array<T, inputs> _in;
+        std::array<T, outputs> _out;
+        std::array<T, maxWidth()> _buff[2];
+
+        // Capa K: lee src y escribe en el buffer alterno o en la salida final.
+        template<size_t K>
+        OPCODE step(const T* src, T* dst_final)
+        {
+            T* dst = (K+1 == _n) ? dst_final : _buff[K%2].data();
+            OPCODE code = std::get<K>(_layers).compute(src, dst);
+            if constexpr (K+1 < _n)
+            {
+                if (code != OPCODE::OK)
+                    return code;
+                return step<K+1>(dst, dst_final);
+            }
+            return code;
+        }
+
+    public:
+        // Acceso a la capa K para configurarla: net.layer<1>().load("w.csv", "b.csv")
+        template<size_t K>
+        auto& layer() {return std::get<K>(_layers);}
+        template<size_t K>
+        const auto& layer() const {return std::get<K>(_layers);}
+
+        OPCODE compute(const T* in, T* out) {return step<0>(in, out);}
+        OPCODE compute() {return step<0>(_in.data(), _out.data());}
+        OPCODE operator()() {return compute();}
+
+        void copy2input(const T* origin) {std::copy(origin, origin+inputs, _in.begin());}
+        void copyout(T* dest) const {std::copy(_out.begin(), _out.end(), dest);}
+
+        T* getInput() {return _in.data();}
+        const T* getOutput() const {return _out.data();}
+
+        static constexpr size_t getInputSize() {return inputs;}
+        static constexpr size_t getOutputSize() {return outputs;}
+        static constexpr size_t n_layers() {return _n;}
+};
+
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef __NN_NNTHREADS__
+#define __NN_NNTHREADS__
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <exception>
+
+// Trabajo mínimo (multiplicaciones-suma) para repartir una capa entre hilos
+#ifndef NN_PARALLEL_MIN_WORK
+#define NN_PARALLEL_MIN_WORK (1 << 16)
+#endif
+
+namespace NN{
+
+/*
+    Pool de hilos para paralelismo dentro de una capa.
+
+    parallel_for(n, grain, f) reparte [0, n) en trozos de grain elementos y
+    llama a f(begin, end) desde los hilos del pool y desde el propio llamante,
+    que participa y espera a que terminen todos los trozos. Si el pool ya está
+    ocupado (llamada anidada o desde otro hilo) el trabajo se hace en serie en
+    el llamante, así que nunca se bloquea esperando a sí mismo. Ocupado es un
+    flag atómico y no un mutex: la llamada anidada viene del mismo hilo que lo
+    tomó, y try_lock sobre un mutex propio no está definido.
+    Si f lanza una excepción en cualquier hilo, no se empiezan más trozos, se
+    espera a los que estén en marcha y se relanza la primera en el llamante.
+*/
+class ThreadPool
+{
+    private:
+        std::vector<std::thread> _workers;
+        std::mutex _m;
+        std::condition_variable _cv_work, _cv_done;
+        std::atomic<bool> _busy{false}; // Hay una tarea repartida en curso
+        const std::function<void(size_t, size_t)>* _task = nullptr;
+        size_t _n = 0, _grain = 1, _active = 0;
+        std::atomic<size_t> _next{0};
+        unsigned long _gen = 0;
+        bool _stop = false;
+        std::exception_ptr _error; // Primera excepción de la tarea en curso
+
+        void runChunks()
+        {
+            try
+            {
+                for (;;)
+                {
+                    size_t begin = _next.fetch_add(_grain);
+                    if (begin >= _n)
+                        return;
+                    (*_task)(begin, std::min(begin+_grain, _n));
+                }
+            }
+            catch(...)
+            {
+                _next = _n; // Nadie empieza trozos nuevos
+                std::lock_guard<std::mutex> lk(_m);
+                if (!_error)
+                    _error = std::current_exception();
+            }
+        }
+        void worker()
+        {
+            unsigned long seen = 0;
+            std::unique_lock<std::mutex> lk(_m);
+            for (;;)
+            {
+                _cv_work.wait(lk, [&]{return _stop || _gen != seen;});
+                if (_stop)
+                    return;
+                seen = _gen;
+                lk.unlock();
+                runChunks();
+                lk.lock();
+                if (--_active == 0)
+                    _cv_done.notify_one();
+            }
+        }
+    public:
+        // threads cuenta también al hilo llamante: ThreadPool(1) no crea hilos.
+        explicit ThreadPool(size_t threads = std::thread::hardware_concurrency())
+        {
+            for (size_t k = 1; k < threads; k++)
+                _workers.emplace_back([this]{worker();});
+        }
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lk(_m);
+                _stop = true;
+            }
+            _cv_work.notify_all();
+            for (auto &w : _workers)
+                w.join();
+        }
+
+        size_t size() const {return _workers.size()+1;}
+
+        template<typename F>
+        void parallel_for(size_t n, size_t grain, F &&f)
+        {
+            if (n == 0)
+                return;
+            grain = std::max<size_t>(grain, 1);
+            bool idle = false;
+            if (_workers.empty() || n <= grain || !_busy.compare_exchange_strong(idle, true, std::memory_order_acquire))
+            {
+                f(size_t(0), n);
+                return;
+            }
+            struct Release
+            {
+                std::atomic<bool> &busy;
+                ~Release() {busy.store(false, std::memory_order_release);}
+            } release{_busy};
+            const std::function<void(size_t, size_t)> task = [&f](size_t b, size_t e){f(b, e);};
+            {
+                std::lock_guard<std::mutex> lk(_m);
+                _task = &task;
+                _n = n;
+                _grain = grain;
+                _next = 0;
+                _active = _workers.size();
+                ++_gen;
+            }
+            _cv_work.notify_all();
+            runChunks();
+            std::exception_ptr error;
+            {
+                std::unique_lock<std::mutex> lk(_m);
+                _cv_done.wait(lk, [&]{return _active == 0;});
+                _task = nullptr;
+                std::swap(error, _error);
+            }
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        // Trozo para repartir n elementos en unas 4 partes por hilo, múltiplo de align
+        size_t grainFor(size_t n, size_t align = 1) const
+        {
+            size_t g = (n + 4*size() - 1)/(4*size());
+            return std::max<size_t>(align, (g + align - 1)/align*align);
+        }
+};
+
+/*
+    Reparto de [0, n) entre workers con robo de trabajo.
+
+    Cada worker consume trozos de grain elementos del principio de su rango.
+    Cuando lo agota roba la mitad final del rango de otro worker, así los
+    trozos caros no dejan hilos parados al final del lote.
+*/
+class WorkStealingRanges
+{
+    private:
+        struct alignas(64) Range
+        {
+            std::mutex m;
+            size_t begin = 0, end = 0;
+        };
+        std::unique_ptr<Range[]> _r;
+        size_t _workers, _grain;
+
+        bool take(Range &own, size_t &begin, size_t &end)
+        {
+            std::lock_guard<std::mutex> lk(own.m);
+            if (own.begin >= own.end)
+                return false;
+            begin = own.begin;
+            end = std::min(own.begin+_grain, own.end);
+            own.begin = end;
+            return true;
+        }
+    public:
+        WorkStealingRanges(size_t n, size_t workers, size_t grain) : _r(new Range[std::max<size_t>(workers, 1)]), _workers(std::max<size_t>(workers, 1)), _grain(std::max<size_t>(grain, 1))
+        {
+            for (size_t w = 0; w < _workers; w++)
+            {
+                _r[w].begin = n*w/_workers;
+                _r[w].end = n*(w+1)/_workers;
+            }
+        }
+
+        size_t workers() const {return _workers;}
+
+        // Siguiente trozo [begin, end) para el worker w. false cuando no queda trabajo.
+        bool next(size_t w, size_t &begin, size_t &end)
+        {
+            Range &own = _r[w];
+            while (!take(own, begin, end))
+            {
+                bool stolen = false;
+                for (size_t k = 1; k < _workers && !stolen; k++)
+                {
+                    Range &victim = _r[(w+k)%_workers];
+                    size_t b, e;
+                    {
+                        std::lock_guard<std::mutex> lk(victim.m);
+                        if (victim.begin >= victim.end)
+                            continue;
+                        size_t left = victim.end - victim.begin;
+                        b = left > _grain ? victim.end - left/2 : victim.begin;
+                        e = victim.end;
+                        victim.end = b;
+                    }
+                    std::lock_guard<std::mutex> lk(own.m);
+                    own.begin = b;
+                    own.end = e;
+                    stolen = true;
+                }
+                if (!stolen)
+                    return false;
+            }
+            return true;
+        }
+};
+
+// Pool compartido para quien no configura uno propio
+inline ThreadPool& defaultThreadPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+}
+
+#endif
@@ -9,6 +9,22 @@
 #include "./libs/toml11/toml.hpp"
 #include <exception>
 #include <sstream>
+#include <memory>
+#include <new>
+#include <vector>
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include "NNThreads.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NN_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 #define NN_BUFF_SIZE_FS_REISERFS 4096
@@ -19,12 +35,23 @@
 
 #ifndef NN_PARSECSV_BUFF_USER_SIZE
 #define NN_PARSECSV_BUFF_SIZE 1024 // Default
-#elif
-#define NN_PARSECSV_BUFF_SIZE NN_PARSECSV_BUFF_USER_SIZE // Default
+#else
+#define NN_PARSECSV_BUFF_SIZE NN_PARSECSV_BUFF_USER_SIZE
+#endif
+
+// Tamaño a partir del cual parseCSV reparte el fichero entre hilos
+#ifndef NN_PARSECSV_PARALLEL_MIN
+#define NN_PARSECSV_PARALLEL_MIN (1 << 20)
 #endif
 
 #define NN_NO_WARNINGS // Comment to enable warns
 
+#define NN_ALIGN 64 // Alineamiento de los bloques de activaciones (línea de caché)
+
+#ifndef NN_BATCH_TILE
+#define NN_BATCH_TILE 64 // Muestras por bloque en Net::computeBatch
+#endif
+
 namespace NN{
 
 enum class OPCODE : uint16_t {
@@ -51,6 +78,12 @@ enum class EXCEPLEVEL : char {
     THROW_ALL
 };
 
+// Reescrituras del grafo en Net::init()
+enum class OPTLEVEL : char {
+    NONE = 0,
+    FOLD    // Norm->WG, WG->WG y capas identidad
+};
+
 std::ostream& operator<<(std::ostream& os, const OPCODE &code)
 {
     os << "[OPCODE]: ";
@@ -142,126 +175,277 @@ struct LoadError : public std::exception
 };
 
 
-template <typename T>
-typename std::enable_if<std::is_floating_point<T>::value, int>::type parseCSV(FILE *pFile, T *dest, uint_fast16_t dest_len)
+// Traduce el valor devuelto por parseCSV a un código de operación.
+inline OPCODE parseStatus(int64_t ret)
 {
-    char num[40];
-    char buff[NN_PARSECSV_BUFF_SIZE];
+    switch (ret)
+    {
+    case -1:
+        return OPCODE::PARS_ERROR_0;
+    case -2:
+        return OPCODE::PARS_ERROR_1;
+    case -3:
+        return OPCODE::PARS_ERROR_2;
+    case -4:
+        return OPCODE::PARS_ERROR_3;
+    case 0:
+        return OPCODE::OK;
+    default:
+        #ifndef NN_NO_WARNINGS
+        return OPCODE::WARN_0;
+        #else
+        return OPCODE::OK;
+        #endif
+    }
+}
 
-    if(pFile==NULL)
-        return -1;
+namespace detail{
 
-    if(ferror(pFile))
-        return -2;
+// Separadores: coma y cualquier carácter de control o espacio
+inline bool isCSVSep(char c) {return c == ',' || static_cast<unsigned char>(c) <= 0x20;}
 
-    if(feof(pFile))
-        return -3;
+/* Lee un número en [p, end) y devuelve el puntero tras él, o nullptr si el
+   token no es un número completo. Los float se leen como double y se
+   redondean, igual que hacía atof. */
+template<typename T>
+const char* parseToken(const char* p, const char* end, T &value)
+{
+    if (p != end && *p == '+')
+        ++p;
+    using R = typename std::conditional<std::is_floating_point<T>::value, double, T>::type;
+    R v;
+    auto res = std::from_chars(p, end, v);
+    if (res.ec == std::errc::result_out_of_range && std::is_floating_point<T>::value)
+    {
+        // Fuera de rango (p. ej. subnormales): strtod da el mismo valor que atof
+        char num[64];
+        size_t len = std::min<size_t>(res.ptr - p, sizeof(num)-1);
+        std::memcpy(num, p, len);
+        num[len] = '\0';
+        v = static_cast<R>(std::strtod(num, nullptr));
+    }
+    else if (res.ec != std::errc())
+        return nullptr;
+    if (res.ptr != end && !isCSVSep(*res.ptr))
+        return nullptr;
+    value = static_cast<T>(v);
+    return res.ptr;
+}
 
-    fseek(pFile, 0L, SEEK_END);
-    size_t f_size = ftell(pFile);
-    rewind(pFile);
-    
-    int n_tokens = f_size/NN_PARSECSV_BUFF_SIZE;
+inline const char* skipCSVSeps(const char* p, const char* end)
+{
+    while (p != end && isCSVSep(*p))
+        ++p;
+    return p;
+}
 
-    size_t i ;
-    size_t j = 0;
+inline size_t countCSVTokens(const char* p, const char* end)
+{
     size_t n = 0;
+    for (;;)
+    {
+        p = skipCSVSeps(p, end);
+        if (p == end)
+            return n;
+        ++n;
+        while (p != end && !isCSVSep(*p))
+            ++p;
+    }
+}
 
-    while(n_tokens >= 0)
+/* Lee hasta max valores de [p, end). Devuelve los leídos o -1 si hay un token
+   inválido; en stop deja dónde se ha parado. */
+template<typename T>
+int64_t parseCSVRange(const char* p, const char* end, T* dest, size_t max, const char** stop = nullptr)
+{
+    size_t n = 0;
+    while (n < max)
     {
-        size_t r = fread(buff, 1, NN_PARSECSV_BUFF_SIZE, pFile);
-        if(!(n_tokens--) && r < NN_PARSECSV_BUFF_SIZE)
-            buff[r++] = '\0';
-        i = 0;
-        while(i<r)
-        {
-            if (n == dest_len)
-                return n;
+        p = skipCSVSeps(p, end);
+        if (p == end)
+            break;
+        p = parseToken(p, end, dest[n]);
+        if (!p)
+            return -1;
+        ++n;
+    }
+    if (stop)
+        *stop = p;
+    return n;
+}
+
+/* Trozos que empiezan en un token: los cortes nominales se adelantan hasta
+   el siguiente separador. */
+inline std::vector<const char*> splitCSV(const char* begin, const char* end, size_t chunks)
+{
+    std::vector<const char*> cuts{begin};
+    const size_t len = end - begin;
+    for (size_t c = 1; c < chunks; c++)
+    {
+        const char* p = std::max(begin + len*c/chunks, cuts.back());
+        while (p != end && !isCSVSep(*p))
+            ++p;
+        cuts.push_back(p);
+    }
+    cuts.push_back(end);
+    return cuts;
+}
 
-            char c = buff[i++];
+/* Lee [begin, end) como parseCSV. Sin pool se usa el compartido a partir de
+   NN_PARSECSV_PARALLEL_MIN bytes; con pool se reparte siempre entre sus hilos. */
+template<typename T>
+int64_t parseCSVBuffer(const char* begin, const char* end, T* dest, size_t dest_len, ThreadPool* pool = nullptr)
+{
+    if (begin == end)
+        return -3;
 
-            if (c >= '0' && c <= '9' || c == '.' || c == '-' || c == '+' || c == 'e')
+    const size_t len = end - begin;
+    if (!pool && len >= NN_PARSECSV_PARALLEL_MIN)
+        pool = &defaultThreadPool();
+    size_t total = 0;
+    bool bad = false;
+    if (!pool || pool->size() == 1)
+    {
+        const char* stop;
+        int64_t n = parseCSVRange(begin, end, dest, dest_len, &stop);
+        if (n < 0)
+            return -4;
+        total = n;
+        if (total == dest_len && skipCSVSeps(stop, end) != end)
+            ++total; // Al menos un valor de más
+    }
+    else
+    {
+        // Dos pasadas en paralelo: contar tokens por trozo y luego leer cada trozo en su sitio
+        const auto cuts = splitCSV(begin, end, 4*pool->size());
+        const size_t chunks = cuts.size()-1;
+        std::vector<size_t> count(chunks), offset(chunks);
+        pool->parallel_for(chunks, 1, [&](size_t c0, size_t c1){
+            for (size_t c = c0; c < c1; c++)
+                count[c] = countCSVTokens(cuts[c], cuts[c+1]);
+        });
+        for (size_t c = 0; c < chunks; c++)
+        {
+            offset[c] = total;
+            total += count[c];
+        }
+        std::atomic<bool> error{false};
+        pool->parallel_for(chunks, 1, [&](size_t c0, size_t c1){
+            for (size_t c = c0; c < c1; c++)
             {
-                num[j++] = c;
-                continue;
+                if (offset[c] >= dest_len)
+                    continue;
+                size_t max = std::min(count[c], dest_len - offset[c]);
+                if (parseCSVRange(cuts[c], cuts[c+1], dest + offset[c], max) != int64_t(max))
+                    error = true;
             }
+        });
+        bad = error;
+    }
 
-            if ((c == ',') || (c <= '\x20'))
+    if (bad)
+        return -4;
+    if (total < dest_len) // Faltan datos
+        return -4;
+    if (total > dest_len) // Sobran datos
+        return dest_len;
+    return 0;
+}
+
+// Contenido de un fichero abierto: mapeado si se puede, leído si no.
+class CSVFile
+{
+    private:
+        const char* _data = nullptr;
+        size_t _len = 0;
+        bool _mapped = false;
+        std::vector<char> _buff;
+    public:
+        explicit CSVFile(FILE* f)
+        {
+            #ifdef NN_HAS_MMAP
+            struct stat st;
+            int fd = fileno(f);
+            if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
             {
-                num[j++] = '\0';
-                dest[n++] = atof(num);
-                j = 0;
-            } else {
-                return -4;
+                void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    madvise(p, st.st_size, MADV_SEQUENTIAL);
+                    _data = static_cast<const char*>(p);
+                    _len = st.st_size;
+                    _mapped = true;
+                    return;
+                }
             }
+            #endif
+            // Igual que el mapeo: siempre desde el principio del fichero
+            rewind(f);
+            char chunk[NN_PARSECSV_BUFF_SIZE];
+            size_t r;
+            while ((r = fread(chunk, 1, sizeof(chunk), f)) > 0)
+                _buff.insert(_buff.end(), chunk, chunk+r);
+            _data = _buff.data();
+            _len = _buff.size();
         }
-    };
+        CSVFile(const CSVFile&) = delete;
+        CSVFile& operator=(const CSVFile&) = delete;
+        ~CSVFile()
+        {
+            #ifdef NN_HAS_MMAP
+            if (_mapped)
+                munmap(const_cast<char*>(_data), _len);
+            #endif
+        }
+        const char* begin() const {return _data;}
+        const char* end() const {return _data + _len;}
+};
 
-    if (n==dest_len)
-        return 0;
-    
-    return n;
 }
 
+/* Lee dest_len valores separados por comas o espacios.
+   Devuelve 0 si ha leído exactamente dest_len, dest_len si sobran datos en
+   el fichero, -1 sin fichero, -2 error de lectura, -3 fichero vacío y -4 si
+   faltan datos o hay un valor mal formado. Ver parseStatus(). */
 template <typename T>
-typename std::enable_if<std::is_integral<T>::value, int>::type parseCSV(FILE *pFile, T *dest, uint_fast16_t dest_len)
+typename std::enable_if<std::is_arithmetic<T>::value, int64_t>::type parseCSV(FILE *pFile, T *dest, size_t dest_len)
 {
-    char num[30];
-    char buff[NN_PARSECSV_BUFF_SIZE];
-
     if(pFile==NULL)
         return -1;
 
     if(ferror(pFile))
         return -2;
 
-    if(feof(pFile))
-        return -3;
-
-    fseek(pFile, 0L, SEEK_END);
-    size_t f_size = ftell(pFile);
-    rewind(pFile);
-    
-    int n_tokens = f_size/NN_PARSECSV_BUFF_SIZE;
-
-    size_t i ;
-    size_t j = 0;
-    size_t n = 0;
-
-    while(n_tokens >= 0)
-    {
-        size_t r = fread(buff, 1, NN_PARSECSV_BUFF_SIZE, pFile);
-        if(!(n_tokens--) && r < NN_PARSECSV_BUFF_SIZE)
-            buff[r++] = '\0';
-        i = 0;
-        while(i<r)
-        {
-            if (n == dest_len)
-                return n;
-
-            char c = buff[i++];
+    detail::CSVFile file(pFile);
+    if(ferror(pFile))
+        return -2;
+    return detail::parseCSVBuffer(file.begin(), file.end(), dest, dest_len);
+}
 
-            if (c >= '0' && c <= '9' || c == '-' || c == '+')
-            {
-                num[j++] = c;
-                continue;
-            }
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, int64_t>::type parseCSV(const char* filename, T *dest, size_t dest_len)
+{
+    FILE* f = fopen(filename, "rb");
+    int64_t ret = parseCSV(f, dest, dest_len);
+    if(f)
+        fclose(f);
+    return ret;
+}
 
-            if ((c == ',') || (c <= '\x20'))
-            {
-                num[j++] = '\0';
-                dest[n++] = atoi(num);
-                j = 0;
-            } else {
-                return -4;
-            }
-        }
-    };
+// Bloque de n elementos alineado a NN_ALIGN bytes.
+template<typename T>
+std::shared_ptr<T> alignedBlock(size_t n)
+{
+    T* ptr = static_cast<T*>(::operator new[](n*sizeof(T), std::align_val_t(NN_ALIGN)));
+    return std::shared_ptr<T>(ptr, [](T* p){::operator delete[](p, std::align_val_t(NN_ALIGN));});
+}
 
-    if (n==dest_len)
-        return 0;
-    
-    return n;
+// Redondea n elementos de T a un múltiplo de NN_ALIGN bytes.
+template<typename T>
+size_t alignedLen(size_t n)
+{
+    constexpr size_t step = NN_ALIGN/sizeof(T) > 0 ? NN_ALIGN/sizeof(T) : 1;
+    return (n+step-1)/step*step;
 }
 
 typedef struct Dimensions
@@ -291,6 +475,103 @@ enum class ConvPadding : char
     VALID, SAME
 };
 
+// Algoritmo de ConvLayer. AUTO lo elige en setKernel() según el kernel y la imagen.
+enum class ConvMethod : char
+{
+    AUTO, DIRECT, WINOGRAD_2X2, WINOGRAD_4X4, SEPARABLE, FFT
+};
+
+// Orden de los datos de Conv2DLayer: canal, fila, columna o fila, columna, canal
+enum class Layout : char
+{
+    NCHW, NHWC
+};
+
+// Valor fuera de la imagen en Conv2DLayer: ceros o el borde más cercano
+enum class PadMode : char
+{
+    ZERO, REPLICATE
+};
+
+/* Configuración de Conv2DLayer. Las dimensiones van como dim_t (cols, rows).
+   Salida: Ho = (H + 2*pad.rows - dilation.rows*(kernel.rows-1) - 1)/stride.rows + 1,
+   igual para Wo con las columnas. */
+struct Conv2DParams
+{
+    uint16_t channels = 1;  // Canales de entrada
+    uint16_t filters = 1;   // Filtros (canales de salida)
+    dim_t input{0, 0};
+    dim_t kernel{3, 3};
+    dim_t stride{1, 1};
+    dim_t dilation{1, 1};
+    dim_t pad{0, 0};        // Relleno por cada lado
+    PadMode pad_mode = PadMode::ZERO;
+    Layout layout = Layout::NCHW;
+
+    // Salida (0, 0) si la configuración no es válida
+    dim_t output() const
+    {
+        auto len = [](long n, long k, long s, long d, long p) -> long {
+            if (n == 0 || k == 0 || s == 0 || d == 0)
+                return 0;
+            long span = n + 2*p - d*(k-1);
+            return span > 0 ? (span-1)/s + 1 : 0;
+        };
+        long ho = len(input.rows, kernel.rows, stride.rows, dilation.rows, pad.rows);
+        long wo = len(input.cols, kernel.cols, stride.cols, dilation.cols, pad.cols);
+        if (ho == 0 || wo == 0 || ho > UINT16_MAX || wo > UINT16_MAX)
+            return dim_t(0, 0);
+        return dim_t(wo, ho);
+    }
+    size_t inputLen() const {return size_t(channels)*input.rows*input.cols;}
+    size_t outputLen() const {dim_t o = output(); return size_t(filters)*o.rows*o.cols;}
+    size_t kernelLen() const {return size_t(channels)*kernel.rows*kernel.cols;} // Pesos por filtro
+};
+
+// Reducción de las capas de pooling
+enum class PoolMode : char
+{
+    MAX, AVG
+};
+
+/* Ventana de MaxPoolLayer/AvgPoolLayer sobre una imagen (dim_t: cols, rows),
+   sin relleno: Ho = (H - size.rows)/stride.rows + 1, igual para Wo. */
+struct PoolParams
+{
+    dim_t input{0, 0};
+    dim_t size{2, 2};
+    dim_t stride{2, 2};
+
+    // Salida (0, 0) si la ventana no cabe o algún paso es cero
+    dim_t output() const
+    {
+        if (size.rows == 0 || size.cols == 0 || stride.rows == 0 || stride.cols == 0 ||
+            size.rows > input.rows || size.cols > input.cols)
+            return dim_t(0, 0);
+        return dim_t((input.cols - size.cols)/stride.cols + 1, (input.rows - size.rows)/stride.rows + 1);
+    }
+    size_t inputLen() const {return size_t(input.rows)*input.cols;}
+    size_t outputLen() const {dim_t o = output(); return size_t(o.rows)*o.cols;}
+};
+
+// Cálculo de exp/sigmoide en las capas de activación (ver NNMath.hpp)
+enum class ActMode : char
+{
+    EXACT, FAST, LUT
+};
+
+// Activación aplicada por WGLayer al escribir su salida (fusión WG+activación)
+enum class Epilogue : char
+{
+    NONE, RELU, SIGMOID, SOFTMAX
+};
+
+// Almacenamiento de los pesos de WGLayer: el tipo de la capa o 16 bits (NNHalf.hpp)
+enum class WeightFormat : char
+{
+    NATIVE, FP16, BF16
+};
+
 }
 
 #endif
\ No newline at end of file
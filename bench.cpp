@@ -0,0 +1,193 @@
+/* Benchmarks de la librería: cada capa con varios tamaños, parseCSV, loadNet y la red de iris.
+
+   g++ -O2 -std=c++17 -pthread bench.cpp -o bench
+   ./bench [--json salida.json] [--baseline base.json] [--threshold 10] [--filter WG] [--min-time 100]
+
+   Con --baseline compara la mediana de cada caso con la de la línea base y
+   termina con código 1 si alguno empeora más del umbral (en %).
+
+   Flops por operación (nominales): WG 2*in*out, Conv 2*kh*kw por salida
+   interior, ReLu y Lambda 1 por elemento, Normalize 2, Sigmoid y SoftMax 4
+   (exp, suma, división y negación o máximo). Bytes: entrada + salida +
+   parámetros leídos una vez por operación. */
+
+#include "./NNLib/NNLib.hpp"
+#include "./NNLib/NNBench.hpp"
+#include "./data/iris.hpp"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <cstring>
+
+int main(int argc, char const *argv[])
+{
+    std::string json, baseline, filter;
+    double threshold = 10, min_ms = 100;
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i+1 == argc)
+        {
+            std::cerr << "Falta el valor de " << argv[i] << std::endl;
+            return 2;
+        }
+        if (!std::strcmp(argv[i], "--json")) json = argv[i+1];
+        else if (!std::strcmp(argv[i], "--baseline")) baseline = argv[i+1];
+        else if (!std::strcmp(argv[i], "--filter")) filter = argv[i+1];
+        else if (!std::strcmp(argv[i], "--threshold")) threshold = std::atof(argv[i+1]);
+        else if (!std::strcmp(argv[i], "--min-time")) min_ms = std::atof(argv[i+1]);
+        else
+        {
+            std::cerr << "Opción desconocida: " << argv[i] << std::endl;
+            return 2;
+        }
+    }
+
+    NN::kernels::initKernels();
+    const std::string isa = NN::kernels::isaName(NN::kernels::activeISA());
+    std::cout << "ISA: " << isa << std::endl;
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    auto fill = [&](float* p, size_t n){for (size_t i = 0; i < n; i++) p[i] = dist(gen);};
+    const double F = sizeof(float);
+    NN::bench::Runner runner(min_ms, filter);
+
+    // WG
+    for (size_t n : {16, 64, 256, 1024})
+    {
+        NN::WGLayer<float> wg(n, n);
+        fill(wg.getMutInputBlock(), n);
+        fill(wg.getMutWeights(), n*n);
+        fill(wg.getMutBias(), n);
+        wg.pack();
+        runner.run("WG/" + std::to_string(n) + "x" + std::to_string(n), 2.0*n*n, F*(n*n + 3*n), [&]{wg.compute();});
+    }
+
+    // Conv 2D (AUTO) y 1D
+    for (size_t side : {32, 128, 250})
+    {
+        for (size_t k : {3, 5, 7})
+        {
+            NN::ConvLayer<float> conv(NN::dim_t(side, side));
+            std::vector<float> kernel(k*k);
+            fill(kernel.data(), k*k);
+            fill(conv.getMutInputBlock(), side*side);
+            conv.setKernel({{uint16_t(k), uint16_t(k)}, kernel.data()});
+            const double inner = double(side-k+1)*(side-k+1);
+            runner.run("Conv/" + std::to_string(side) + "x" + std::to_string(side) + "/k" + std::to_string(k),
+                       2.0*k*k*inner, F*(2.0*side*side + k*k), [&]{conv.compute();});
+        }
+    }
+    {
+        const size_t n = 16384, k = 63;
+        NN::ConvLayer<float> conv{NN::dim_t(n)};
+        std::vector<float> kernel(k);
+        fill(kernel.data(), k);
+        fill(conv.getMutInputBlock(), n);
+        conv.setKernel({{uint16_t(k)}, kernel.data()});
+        runner.run("Conv/1D16384/k63", 2.0*k*(n-k+1), F*(2.0*n + k), [&]{conv.compute();});
+    }
+
+    // Capas elemento a elemento
+    for (size_t n : {64, 1024, 16384})
+    {
+        const std::string len = std::to_string(n);
+        NN::ReLuLayer<float> relu(n);
+        fill(relu.getMutInputBlock(), n);
+        runner.run("ReLu/" + len, n, F*2*n, [&]{relu.compute();});
+
+        NN::NormLayer<float> norm(n);
+        fill(norm.getMutInputBlock(), n);
+        fill(norm.getMutMeans(), n);
+        for (size_t i = 0; i < n; i++)
+            norm.getMutSD()[i] = 1.0f + std::fabs(dist(gen));
+        runner.run("Normalize/" + len, 2.0*n, F*4*n, [&]{norm.compute();});
+
+        NN::SigmoidLayer<float> sig(n);
+        fill(sig.getMutInputBlock(), n);
+        runner.run("Sigmoid/" + len, 4.0*n, F*2*n, [&]{sig.compute();});
+
+        NN::SoftMaxLayer<float> soft(n);
+        fill(soft.getMutInputBlock(), n);
+        runner.run("SoftMax/" + len, 4.0*n, F*2*n, [&]{soft.compute();});
+
+        NN::LambdaLayer<float> lambda(n, n);
+        fill(lambda.getMutInputBlock(), n);
+        lambda.setApp([](float* in, float* out, uint16_t, uint16_t so){
+            for (size_t i = 0; i < so; i++)
+                out[i] = 2*in[i];
+        });
+        runner.run("Lambda/" + len, n, F*2*n, [&]{lambda.compute();});
+    }
+
+    // parseCSV sobre un fichero temporal
+    for (size_t n : {1000, 100000})
+    {
+        FILE* f = std::tmpfile();
+        if (!f)
+            break;
+        for (size_t i = 0; i < n; i++)
+            std::fprintf(f, "%.7f%c", dist(gen), i+1 < n ? ',' : '\n');
+        std::fflush(f);
+        const double bytes = std::ftell(f);
+        std::vector<float> dest(n);
+        runner.run("parseCSV/" + std::to_string(n), 0, bytes, [&]{
+            std::rewind(f);
+            NN::parseCSV(f, dest.data(), n);
+        });
+        std::fclose(f);
+    }
+
+    // Arranque desde el .toml (lee los csv de ./data)
+    runner.run("loadNet/nn1.toml", 0, 0, [&]{
+        auto net = NN::loadNet<float>("./data/nn1.toml");
+        net.init();
+        NN::bench::keep(net.getOutput());
+    });
+
+    // Red de iris completa
+    {
+        NN::Net<float> net(4);
+        net.addNormLayer("./data/means.csv", "./data/sd.csv");
+        net.addWGLayer(8, "./data/w1.csv", "./data/b1.csv");
+        net.addReLuLayer();
+        net.addWGLayer(3, "./data/w2.csv", "./data/b2.csv");
+        net.addSoftMaxLayer();
+        net.init();
+        const double flops = 2*4 + 2.0*4*8 + 8 + 2.0*8*3 + 4*3;
+        const double params = F*(2*4 + 4*8 + 8 + 8*3 + 3);
+        size_t i = 0;
+        runner.run("Net/iris/compute", flops, params + F*(4 + 3), [&]{
+            net.copy2input(data[i]);
+            net.compute();
+            i = (i+1) % 150;
+        });
+        std::vector<float> out(150*3);
+        runner.run("Net/iris/batch150", 150*flops, params + F*150*(4 + 3), [&]{
+            net.computeBatch(&data[0][0], out.data(), 150);
+        });
+    }
+
+    runner.print(std::cout);
+
+    if (!json.empty())
+    {
+        std::ofstream os(json);
+        runner.writeJSON(os, isa);
+        std::cout << "Resultados en " << json << std::endl;
+    }
+    if (!baseline.empty())
+    {
+        std::ifstream is(baseline);
+        if (!is)
+        {
+            std::cerr << "No se puede abrir la línea base " << baseline << std::endl;
+            return 2;
+        }
+        size_t bad = NN::bench::compare(runner.results(), NN::bench::readJSON(is), threshold/100, std::cout);
+        std::cout << bad << " regresiones (umbral " << threshold << " %)" << std::endl;
+        return bad ? 1 : 0;
+    }
+    return 0;
+}
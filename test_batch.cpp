@@ -0,0 +1,37 @@
+/* Ejemplo de inferencia por lotes */
+
+#include "./NNLib/NNLib.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+
+float res_batch[150][3];
+float res_single[150][3];
+
+int main(int argc, char const *argv[])
+{
+    auto net = NN::loadNet<float>("./data/nn1.toml");
+    net.init();
+
+    // Muestra a muestra
+    for (size_t i = 0; i < 150; i++)
+    {
+        net.copy2input(data[i]);
+        net.compute();
+        net.copyout(res_single[i]);
+    }
+
+    // Todo el lote de una vez
+    net.computeBatch(data[0], res_batch[0], 150);
+
+    float max_err = 0;
+    for (size_t i = 0; i < 150; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            max_err = std::max(max_err, std::abs(res_batch[i][j]-res_single[i][j]));
+        }
+    }
+    std::cout << "Error máximo lote vs muestra: " << max_err << std::endl;
+
+    return max_err < 1e-5f ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+/* Ejemplo: peticiones de una muestra desde varios hilos agrupadas en lotes */
+
+#include "./NNLib/NNBatching.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+#include <thread>
+#include <stdexcept>
+#include <chrono>
+
+#define N_THREADS 8
+
+float res_net[150][3];
+float res_exec[N_THREADS][150][3];
+
+int main(int argc, char const *argv[])
+{
+    auto net = NN::loadNet<float>("./data/nn1.toml");
+    net.init();
+    for (size_t i = 0; i < 150; i++)
+    {
+        net.copy2input(data[i]);
+        net.compute();
+        net.copyout(res_net[i]);
+    }
+
+    NN::BatchingExecutor<float> exec(net, 32, 200); // Lotes de hasta 32, espera máxima 200 us
+    std::vector<std::thread> clients;
+    for (size_t t = 0; t < N_THREADS; t++)
+    {
+        clients.emplace_back([&exec, t](){
+            std::vector<std::future<std::vector<float>>> results;
+            for (size_t i = 0; i < 150; i++)
+                results.push_back(exec.submit(data[i]));
+            for (size_t i = 0; i < 150; i++)
+            {
+                auto y = results[i].get();
+                std::copy(y.begin(), y.end(), res_exec[t][i]);
+            }
+        });
+    }
+    for (auto &c : clients)
+        c.join();
+
+    // También con callback
+    std::promise<void> done;
+    exec.submit(data[0], [&done](const float* out, size_t len){
+        std::cout << "Callback: " << out[0] << " " << out[1] << " " << out[2] << std::endl;
+        done.set_value();
+    });
+    done.get_future().wait();
+
+    // Un callback que lanza no tumba el despachador ni deja el resto del lote sin atender
+    for (size_t i = 0; i < 10; i++)
+        exec.submit(data[i], [](const float* out, size_t len){throw std::runtime_error("callback");});
+    auto after = exec.submit(data[1]);
+    bool survived = after.get()[0] == res_net[1][0] && exec.callbackErrors() == 10;
+    std::cout << "Callbacks con excepción: " << exec.callbackErrors() << (survived ? ", el despachador sigue" : ", FALLO") << std::endl;
+
+    // Tras un rato sin peticiones el despachador duerme; submit() lo despierta
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto t0 = std::chrono::steady_clock::now();
+    auto woken = exec.submit(data[2]).get();
+    auto wake_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Respuesta tras dormir: " << wake_us << " us" << std::endl;
+    survived = survived && woken[0] == res_net[2][0];
+
+    float max_err = 0;
+    for (size_t t = 0; t < N_THREADS; t++)
+        for (size_t i = 0; i < 150; i++)
+            for (size_t j = 0; j < 3; j++)
+                max_err = std::max(max_err, std::abs(res_exec[t][i][j]-res_net[i][j]));
+
+    std::cout << "Tamaño de lote:\n" << exec.batchSizes();
+    std::cout << "Espera en cola (us):\n" << exec.queueDelayUs();
+    std::cout << "Error máximo lotes vs red: " << max_err << std::endl;
+
+    return max_err < 1e-5f && survived ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+/* Ejemplo: guardar la red en formato binario y cargarla mapeando el fichero */
+
+#include "./NNLib/NNFormat.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+#include <cstring>
+#include <chrono>
+
+float res_toml[150][3];
+float res_bin[150][3];
+
+int main(int argc, char const *argv[])
+{
+    auto t0 = std::chrono::steady_clock::now();
+    auto net = NN::loadNet<float>("./data/nn1.toml");
+    net.init();
+    auto t1 = std::chrono::steady_clock::now();
+    NN::saveNet(net, "./nn1.nnb");
+
+    auto t2 = std::chrono::steady_clock::now();
+    auto bin = NN::loadNetBin<float>("./nn1.nnb");
+    bin.init();
+    auto t3 = std::chrono::steady_clock::now();
+    std::remove("./nn1.nnb");
+
+    std::cout << "Carga toml+csv: " << std::chrono::duration<double, std::micro>(t1-t0).count() << " us" << std::endl;
+    std::cout << "Carga binaria:  " << std::chrono::duration<double, std::micro>(t3-t2).count() << " us" << std::endl;
+
+    for (size_t i = 0; i < 150; i++)
+    {
+        net.copy2input(data[i]);
+        net.compute();
+        net.copyout(res_toml[i]);
+        bin.copy2input(data[i]);
+        bin.compute();
+        bin.copyout(res_bin[i]);
+    }
+    bool same = std::memcmp(res_toml, res_bin, sizeof(res_toml)) == 0;
+    std::cout << (same ? "Resultados idénticos" : "Resultados distintos") << std::endl;
+    return same ? 0 : 1;
+}
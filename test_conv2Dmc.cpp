@@ -0,0 +1,113 @@
+/* Ejemplo: Conv2DLayer con varios canales y filtros (im2col + GEMM) */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+// Convolución directa de referencia, entrada y salida en el layout de p
+void reference(const NN::Conv2DParams &p, const float* in, const float* W, const float* B, float* out)
+{
+    const long H = p.input.rows, Wd = p.input.cols, C = p.channels;
+    const NN::dim_t o = p.output();
+    auto at = [&](long c, long y, long x) -> float {
+        if (y < 0 || y >= H || x < 0 || x >= Wd)
+        {
+            if (p.pad_mode == NN::PadMode::ZERO)
+                return 0;
+            y = std::min(std::max(y, 0L), H-1);
+            x = std::min(std::max(x, 0L), Wd-1);
+        }
+        return p.layout == NN::Layout::NCHW ? in[(c*H+y)*Wd+x] : in[(y*Wd+x)*C+c];
+    };
+    for (long f = 0; f < p.filters; f++)
+        for (long oy = 0; oy < o.rows; oy++)
+            for (long ox = 0; ox < o.cols; ox++)
+            {
+                double acc = B[f];
+                for (long c = 0; c < C; c++)
+                    for (long ki = 0; ki < p.kernel.rows; ki++)
+                        for (long kj = 0; kj < p.kernel.cols; kj++)
+                            acc += W[((f*C+c)*p.kernel.rows+ki)*p.kernel.cols+kj] *
+                                   at(c, oy*p.stride.rows-p.pad.rows+ki*p.dilation.rows, ox*p.stride.cols-p.pad.cols+kj*p.dilation.cols);
+                size_t q = oy*o.cols+ox;
+                out[p.layout == NN::Layout::NCHW ? f*o.rows*o.cols+q : q*p.filters+f] = acc;
+            }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    auto random = [&](size_t n){
+        std::vector<float> v(n);
+        for (auto &x : v) x = dist(gen);
+        return v;
+    };
+
+    NN::Conv2DParams cases[4];
+    cases[0].channels = 3; cases[0].filters = 8; cases[0].input = {13, 11}; cases[0].pad = {1, 1};
+    cases[1] = cases[0]; cases[1].stride = {2, 2}; cases[1].pad_mode = NN::PadMode::REPLICATE; cases[1].layout = NN::Layout::NHWC;
+    cases[2] = cases[0]; cases[2].kernel = {5, 3}; cases[2].dilation = {2, 1}; cases[2].pad = {4, 1};
+    cases[3] = cases[2]; cases[3].layout = NN::Layout::NHWC; cases[3].filters = 1; cases[3].stride = {1, 3};
+
+    bool ok = true;
+    for (auto &p : cases)
+    {
+        auto x = random(p.inputLen()), W = random(p.filters*p.kernelLen()), B = random(p.filters);
+        std::vector<float> ref(p.outputLen());
+        reference(p, x.data(), W.data(), B.data(), ref.data());
+
+        NN::Conv2DLayer<float> conv(p);
+        std::copy(W.begin(), W.end(), conv.getMutWeights());
+        std::copy(B.begin(), B.end(), conv.getMutBias());
+        conv.pack();
+        std::copy(x.begin(), x.end(), conv.getMutInputBlock());
+        conv.compute();
+
+        float err = 0;
+        for (size_t i = 0; i < ref.size(); i++)
+            err = std::max(err, std::fabs(ref[i]-conv.getOutputBlock()[i]));
+        NN::dim_t o = p.output();
+        std::cout << (p.layout == NN::Layout::NCHW ? "NCHW " : "NHWC ") << p.channels << "x" << p.input.rows << "x" << p.input.cols
+                  << " -> " << p.filters << "x" << o.rows << "x" << o.cols << ": error max " << err << std::endl;
+        ok = ok && err < 1e-4f;
+    }
+
+    // Red pequeña: conv 3x3 (1->8) + ReLu + conv 3x3 paso 2 (8->16)
+    NN::Conv2DParams c1, c2;
+    c1.filters = 8; c1.input = {28, 28}; c1.pad = {1, 1};
+    c2.channels = 8; c2.filters = 16; c2.input = {28, 28}; c2.stride = {2, 2}; c2.pad = {1, 1};
+    auto W1 = random(c1.filters*c1.kernelLen()), B1 = random(c1.filters);
+    auto W2 = random(c2.filters*c2.kernelLen()), B2 = random(c2.filters);
+    NN::Net<float> net(c1.inputLen());
+    net.addConv2DLayer(c1, W1.data(), B1.data());
+    net.addReLuLayer();
+    net.addConv2DLayer(c2, W2.data(), B2.data());
+    net.init();
+    auto x = random(c1.inputLen());
+    net.copy2input(x.data());
+
+    std::vector<float> h(c1.outputLen()), y(c2.outputLen());
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < 100; k++)
+    {
+        reference(c1, x.data(), W1.data(), B1.data(), h.data());
+        for (auto &v : h) v = std::max(v, 0.0f);
+        reference(c2, h.data(), W2.data(), B2.data(), y.data());
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int k = 0; k < 100; k++)
+        net.compute();
+    auto t2 = std::chrono::steady_clock::now();
+
+    float err = 0;
+    for (size_t i = 0; i < y.size(); i++)
+        err = std::max(err, std::fabs(y[i]-net.getOutput()[i]));
+    std::cout << "Red 1x28x28 -> 16x14x14: error max " << err << std::endl;
+    std::cout << "Directa: " << std::chrono::duration<double, std::micro>(t1-t0).count()/100 << " us, "
+              << "im2col+GEMM: " << std::chrono::duration<double, std::micro>(t2-t1).count()/100 << " us" << std::endl;
+    return (ok && err < 1e-3f) ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/* Ejemplo: parseCSV (códigos de retorno, formatos de número y lectura en paralelo) */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+
+// Fichero temporal con el texto dado, al principio
+FILE* file(const std::string &text)
+{
+    FILE* f = std::tmpfile();
+    std::fwrite(text.data(), 1, text.size(), f);
+    std::rewind(f);
+    return f;
+}
+
+template<typename T>
+int64_t parse(const std::string &text, T* dest, size_t n)
+{
+    FILE* f = file(text);
+    int64_t ret = NN::parseCSV(f, dest, n);
+    std::fclose(f);
+    return ret;
+}
+
+bool check(const char* name, bool ok)
+{
+    std::cout << name << ": " << (ok ? "ok" : "FALLO") << std::endl;
+    return ok;
+}
+
+int main(int argc, char const *argv[])
+{
+    bool ok = true;
+    float f[4];
+    double d[4];
+
+    ok &= check("exacto", parse("1,2.5,-3,4e2\n", f, 4) == 0 && f[0] == 1 && f[1] == 2.5f && f[2] == -3 && f[3] == 400);
+    ok &= check("CRLF y separadores repetidos", parse("1, 2\r\n3 ,,4\r\n", f, 4) == 0 && f[1] == 2 && f[3] == 4);
+    ok &= check("faltan datos (-4)", parse("1,2,3", f, 4) == -4);
+    ok &= check("sobran datos (dest_len)", parse("1,2,3,4,5", f, 4) == 4 && f[3] == 4);
+    ok &= check("token mal formado (-4)", parse("1,2,abc,4", f, 4) == -4 && parse("1,2,3x,4", f, 4) == -4);
+    ok &= check("fichero vacío (-3)", parse("", f, 4) == -3);
+    ok &= check("sin fichero (-1)", NN::parseCSV(static_cast<FILE*>(nullptr), f, 4) == -1);
+    ok &= check("signo +", parse("+1,+2.5,-3,+4e-1", f, 4) == 0 && f[0] == 1 && f[1] == 2.5f && f[3] == 0.4f);
+
+    // Subnormales y fuera de rango: el mismo valor que atof (strtod y redondeo al tipo)
+    const char* extreme = "1e-40,4e-320,1e39,1e400";
+    ok &= check("subnormales y fuera de rango (float)", parse(extreme, f, 4) == 0
+                && f[0] == float(std::strtod("1e-40", nullptr)) && f[0] != 0
+                && f[1] == 0 && std::isinf(f[2]) && std::isinf(f[3]));
+    ok &= check("subnormales y fuera de rango (double)", parse(extreme, d, 4) == 0
+                && d[0] == 1e-40 && d[1] == std::strtod("4e-320", nullptr) && d[1] != 0
+                && d[2] == 1e39 && std::isinf(d[3]));
+
+    // Con el fichero a medio leer se parte igualmente del principio (mapeado o leído)
+    {
+        FILE* m = file("10,20,30,40");
+        std::fgetc(m);
+        std::fgetc(m);
+        bool mapped = NN::parseCSV(m, f, 4) == 0 && f[0] == 10;
+        std::fclose(m);
+        char text[] = "10,20,30,40";
+        FILE* s = fmemopen(text, sizeof(text)-1, "r"); // Sin descriptor: lectura con fread
+        std::fgetc(s);
+        std::fgetc(s);
+        bool read = NN::parseCSV(s, f, 4) == 0 && f[0] == 10 && f[3] == 40;
+        std::fclose(s);
+        ok &= check("posición del FILE*", mapped && read);
+    }
+
+    // Por encima de NN_PARSECSV_PARALLEL_MIN: en paralelo, igual que la lectura serie
+    {
+        std::mt19937 gen(5);
+        std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+        std::string text;
+        size_t n = 0;
+        char num[32];
+        while (text.size() < 2*size_t(NN_PARSECSV_PARALLEL_MIN))
+        {
+            std::snprintf(num, sizeof(num), "%.9g%s", dist(gen), (++n % 16) ? "," : "\n");
+            text += num;
+        }
+        std::vector<float> whole(n), par(n), ser(n);
+        const char* b = text.data();
+        const char* e = b + text.size();
+        NN::ThreadPool pool(4); // Fuerza las dos pasadas en paralelo aunque la máquina tenga un solo núcleo
+        int64_t fret = parse(text, whole.data(), n);
+        int64_t ret = NN::detail::parseCSVBuffer(b, e, par.data(), n, &pool);
+        int64_t sret = NN::detail::parseCSVRange(b, e, ser.data(), n);
+        std::cout << n << " valores, " << text.size() << " bytes" << std::endl;
+        ok &= check("paralelo = serie", fret == 0 && ret == 0 && sret == int64_t(n) && par == ser && whole == ser);
+        std::vector<float> more(n+1);
+        ok &= check("paralelo, faltan datos (-4)", NN::detail::parseCSVBuffer(b, e, more.data(), n+1, &pool) == -4);
+        ok &= check("paralelo, sobran datos (dest_len)", NN::detail::parseCSVBuffer(b, e, par.data(), n-1, &pool) == int64_t(n-1)
+                    && std::equal(par.begin(), par.end()-1, ser.begin()));
+        text[text.size()/2] = 'x';
+        ok &= check("paralelo, token mal formado (-4)", NN::detail::parseCSVBuffer(text.data(), e, par.data(), n, &pool) == -4
+                    && parse(text, par.data(), n) == -4);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/* Ejemplo: convolución directa (interior sin ramas + bordes) en imágenes rectangulares y en 1080p */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+// Referencia: comprobación de bordes en cada píxel (VALID)
+void reference(const float* in, float* out, size_t rows, size_t cols, const float* k, size_t kh, size_t kw)
+{
+    const size_t i0 = kh/2, j0 = kw/2;
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = 0; j < cols; j++)
+        {
+            float acc = 0;
+            if (i >= i0 && i < rows-i0 && j >= j0 && j < cols-j0)
+                for (size_t ki = 0; ki < kh; ki++)
+                    for (size_t kj = 0; kj < kw; kj++)
+                        acc += in[(i-i0+ki)*cols + j-j0+kj]*k[ki*kw+kj];
+            out[i*cols+j] = acc;
+        }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(13);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> k(49);
+    for (auto &v : k) v = dist(gen);
+
+    const NN::dim_t dims[] = {{37, 23}, {5, 64}, {320, 200}};
+    const NN::dim_t kdims[] = {{3, 3}, {5, 5}, {7, 3}, {4, 2}};
+    bool ok = true;
+    for (auto dim : dims)
+    {
+        for (auto kdim : kdims)
+        {
+            NN::ConvLayer<float> conv(dim);
+            std::vector<float> ref(conv.getLayerLen());
+            for (size_t i = 0; i < conv.getLayerLen(); i++)
+                conv.getMutInputBlock()[i] = dist(gen);
+            conv.setMethod(NN::ConvMethod::DIRECT);
+            conv.setKernel({kdim, k.data()});
+            conv.compute();
+            reference(conv.getInputBlock(), ref.data(), dim.rows, dim.cols, k.data(), kdim.rows, kdim.cols);
+            float err = 0, ksum = 0;
+            for (size_t i = 0; i < ref.size(); i++)
+                err = std::max(err, std::fabs(ref[i]-conv.getOutputBlock()[i]));
+            for (size_t i = 0; i < size_t(kdim.rows)*kdim.cols; i++)
+                ksum += std::fabs(k[i]);
+            std::cout << dim.cols << "x" << dim.rows << ", kernel " << kdim.cols << "x" << kdim.rows << ": error max " << err << std::endl;
+            ok = ok && err <= 1e-5f*ksum;
+        }
+    }
+
+    // 1080p: no cabe en una capa (tamaño uint16_t), se mide el núcleo directamente
+    const size_t rows = 1080, cols = 1920;
+    std::vector<float> in(rows*cols), out(rows*cols), ref(rows*cols);
+    for (auto &v : in) v = dist(gen);
+    for (size_t kk : {3, 5, 7})
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        reference(in.data(), ref.data(), rows, cols, k.data(), kk, kk);
+        auto t1 = std::chrono::steady_clock::now();
+        NN::kernels::conv(in.data(), out.data(), cols, k.data(), kk, kk, kk/2, rows-kk/2, kk/2, cols-kk/2);
+        auto t2 = std::chrono::steady_clock::now();
+        for (int n = 0; n < 10; n++)
+            NN::kernels::conv(in.data(), out.data(), cols, k.data(), kk, kk, kk/2, rows-kk/2, kk/2, cols-kk/2);
+        auto t3 = std::chrono::steady_clock::now();
+        float err = 0;
+        for (size_t i = kk/2; i < rows-kk/2; i++)
+            for (size_t j = kk/2; j < cols-kk/2; j++)
+                err = std::max(err, std::fabs(ref[i*cols+j]-out[i*cols+j]));
+        std::cout << "1920x1080 " << kk << "x" << kk << " (" << NN::kernels::isaName(NN::kernels::activeISA()) << "): con ramas "
+                  << std::chrono::duration<double, std::milli>(t1-t0).count() << " ms, interior sin ramas "
+                  << std::chrono::duration<double, std::milli>(t3-t2).count()/10 << " ms, error max " << err << std::endl;
+        ok = ok && err <= 1e-4f;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/* Ejemplo: convolución por FFT con kernels largos frente a la directa */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    struct Case {const char* name; NN::dim_t dim; NN::dim_t kdim;};
+    Case cases[] = {
+        {"1D 32000, 255 coef.", {32000}, {255}},
+        {"1D 1000, 31 coef.", {1000}, {31}},
+        {"2D 250x250, 15x15", {250, 250}, {15, 15}},
+        {"2D 320x200, 31x31", {320, 200}, {31, 31}},
+        {"2D 37x23, 9x5", {37, 23}, {9, 5}},
+    };
+
+    bool ok = true;
+    for (auto &c : cases)
+    {
+        std::vector<float> k(size_t(c.kdim.rows)*c.kdim.cols);
+        float ksum = 0;
+        for (auto &v : k) ksum += std::fabs(v = dist(gen));
+
+        NN::ConvLayer<float> ref(c.dim), fft(c.dim), autom(c.dim);
+        for (size_t i = 0; i < ref.getLayerLen(); i++)
+            ref.getMutInputBlock()[i] = fft.getMutInputBlock()[i] = autom.getMutInputBlock()[i] = dist(gen);
+        ref.setMethod(NN::ConvMethod::DIRECT);
+        ref.setKernel({c.kdim, k.data()});
+        fft.setMethod(NN::ConvMethod::FFT);
+        fft.setKernel({c.kdim, k.data()});
+        autom.setKernel({c.kdim, k.data()});
+
+        float err = 0;
+        for (auto padding : {NN::ConvPadding::VALID, NN::ConvPadding::SAME})
+        {
+            ref.setPadding(padding);
+            fft.setPadding(padding);
+            ref.compute();
+            fft.compute();
+            for (size_t i = 0; i < ref.getLayerLen(); i++)
+                err = std::max(err, std::fabs(ref.getOutputBlock()[i]-fft.getOutputBlock()[i]));
+        }
+
+        auto time = [&](NN::ConvLayer<float> &conv){
+            auto t0 = std::chrono::steady_clock::now();
+            for (int n = 0; n < 20; n++)
+                conv.compute();
+            auto t1 = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::milli>(t1-t0).count()/20;
+        };
+        double td = time(ref), tf = time(fft);
+        // |x| <= 1: el error de la FFT crece con log2(N), se acota por sum|k|
+        const float bound = 1e-5f*ksum;
+        std::cout << c.name << ": error max " << err << " (cota " << bound << "), directa " << td
+                  << " ms, FFT " << tf << " ms, AUTO elige " << (autom.method() == NN::ConvMethod::FFT ? "FFT" : "otro") << std::endl;
+        ok = ok && fft.method() == NN::ConvMethod::FFT && err <= bound;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+/* Ejemplo: plegado del grafo en Net::init() (opt_level(OPTLEVEL::FOLD)) frente a la red sin plegar */
+
+#include "./NNLib/NNLib.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <functional>
+#include <cmath>
+
+// La misma red plegada y sin plegar sobre n entradas aleatorias: error máximo relativo a la salida
+float compare(size_t input, const std::function<void(NN::Net<float>&)> &build, std::vector<std::string> &rewrites, size_t &layers)
+{
+    NN::Net<float> plain(input), folded(input);
+    build(plain);
+    build(folded);
+    folded.opt_level(NN::OPTLEVEL::FOLD);
+    plain.init();
+    folded.init();
+    rewrites = folded.rewrites();
+    layers = folded.n_layers();
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+    float err = 0, norm = 0;
+    for (int n = 0; n < 20; n++)
+    {
+        for (size_t i = 0; i < input; i++)
+            plain.getInput()[i] = folded.getInput()[i] = dist(gen);
+        plain.compute();
+        folded.compute();
+        for (size_t i = 0; i < plain.getOutputSize(); i++)
+        {
+            err = std::max(err, std::fabs(plain.getOutput()[i]-folded.getOutput()[i]));
+            norm = std::max(norm, std::fabs(plain.getOutput()[i]));
+        }
+    }
+    return norm > 0 ? err/norm : err;
+}
+
+bool check(const char* name, float err, const std::vector<std::string> &rewrites, const std::vector<std::string> &expected, size_t layers, size_t expected_layers)
+{
+    bool ok = err < 1e-5f && rewrites == expected && layers == expected_layers;
+    std::cout << name << ": error " << err << ", " << layers << " capas";
+    for (auto &r : rewrites)
+        std::cout << ", \"" << r << "\"";
+    std::cout << (ok ? "" : " FALLO") << std::endl;
+    return ok;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    auto random = [&](size_t n){
+        std::vector<float> v(n);
+        for (auto &x : v) x = dist(gen);
+        return v;
+    };
+    std::vector<std::string> rewrites;
+    size_t layers;
+    bool ok = true;
+
+    // nn1.toml: la Norm se pliega en la primera WG, la ReLu impide unir las dos WG
+    {
+        auto net = NN::loadNet<float>("./data/nn1.toml");
+        auto folded = NN::loadNet<float>("./data/nn1.toml");
+        folded.opt_level(NN::OPTLEVEL::FOLD);
+        net.init();
+        folded.init();
+        float y[150][3], yf[150][3], err = 0;
+        net.computeBatch(data[0], y[0], 150);
+        folded.computeBatch(data[0], yf[0], 150);
+        for (size_t i = 0; i < 150; i++)
+            for (size_t j = 0; j < 3; j++)
+                err = std::max(err, std::fabs(y[i][j]-yf[i][j]));
+        ok &= check("nn1.toml", err, folded.rewrites(), {"fold Normalize[0] into WG[1]"}, folded.n_layers(), 4);
+    }
+
+    // WG->WG: 6x4 + 4x5 = 44 pesos frente a 6x5 = 30, se unen
+    {
+        auto w1 = random(6*4), b1 = random(4), w2 = random(4*5), b2 = random(5);
+        float err = compare(6, [&](NN::Net<float> &n){
+            n.addWGLayer(4, w1.data(), b1.data());
+            n.addWGLayer(5, w2.data(), b2.data());
+            n.addSigmoidLayer();
+        }, rewrites, layers);
+        ok &= check("WG->WG", err, rewrites, {"merge WG[0] and WG[1]"}, layers, 2);
+    }
+
+    // Cuello de botella 16->2->16: unir daría más pesos (256 > 64), se deja igual
+    {
+        auto w1 = random(16*2), b1 = random(2), w2 = random(2*16), b2 = random(16);
+        float err = compare(16, [&](NN::Net<float> &n){
+            n.addWGLayer(2, w1.data(), b1.data());
+            n.addWGLayer(16, w2.data(), b2.data());
+        }, rewrites, layers);
+        ok &= check("WG->WG cuello de botella", err, rewrites, {}, layers, 2);
+    }
+
+    // Identidades, también la capa 0: la primera capa real pasa a leer la entrada de la red
+    {
+        std::vector<float> zeros(5, 0.0f), ones(5, 1.0f), eye(5*5, 0.0f);
+        for (size_t i = 0; i < 5; i++)
+            eye[i*5+i] = 1;
+        auto w = random(5*5), b = random(5);
+        float err = compare(5, [&](NN::Net<float> &n){
+            n.addNormLayer(zeros.data(), ones.data());
+            n.addWGLayer(5, w.data(), b.data());
+            n.addReLuLayer();
+            n.addWGLayer(5, eye.data(), zeros.data());
+            n.addSoftMaxLayer();
+        }, rewrites, layers);
+        ok &= check("identidades", err, rewrites, {"remove identity Normalize[0]", "remove identity WG[3]"}, layers, 3);
+    }
+
+    // Norm con alguna S == 0: no se puede dividir, la Norm se queda delante de la WG y sigue dando su error
+    {
+        std::vector<float> m = random(4), s = {1.0f, 0.5f, 0.0f, 2.0f};
+        auto w = random(4*3), b = random(3);
+        NN::Net<float> net(4);
+        net.addNormLayer(m.data(), s.data());
+        net.addWGLayer(3, w.data(), b.data());
+        net.opt_level(NN::OPTLEVEL::FOLD);
+        net.init();
+        net.compute(); // El error de la capa se informa en la siguiente llamada
+        bool error = net.layer(0)->code() != NN::OPCODE::OK;
+        ok &= check("Norm con S == 0", error ? 0 : 1, net.rewrites(), {}, net.n_layers(), 2)
+              && std::string(net.layer(0)->id()) == "Normalize";
+    }
+
+    // Norm->WG->WG: primero se pliega la Norm y luego se unen las WG
+    {
+        std::vector<float> m = random(3), s = {0.5f, 2.0f, 1.5f};
+        auto w1 = random(3*4), b1 = random(4), w2 = random(4*2), b2 = random(2);
+        float err = compare(3, [&](NN::Net<float> &n){
+            n.addNormLayer(m.data(), s.data());
+            n.addWGLayer(4, w1.data(), b1.data());
+            n.addWGLayer(2, w2.data(), b2.data());
+        }, rewrites, layers);
+        ok &= check("Norm->WG->WG", err, rewrites, {"fold Normalize[0] into WG[1]", "merge WG[1] and WG[2]"}, layers, 1);
+    }
+    // Pesos compartidos (sin copia) por dos redes: plegar no escribe en los bloques del usuario
+    {
+        std::vector<float> m = random(4), s = {0.5f, 2.0f, 1.5f, 4.0f};
+        auto w = random(4*3), b = random(3);
+        std::vector<float> wp(NN::kernels::packedSize<float>(3, 4));
+        NN::kernels::packWeights(w.data(), 3, 4, wp.data());
+        auto block = [](const std::vector<float> &v){
+            std::shared_ptr<float> p{new float[v.size()], std::default_delete<float[]>()};
+            std::copy(v.begin(), v.end(), p.get());
+            return p;
+        };
+        auto W = block(w), B = block(b), Wp = block(wp);
+        NN::Net<float> plain(4), a(4), c(4);
+        plain.addNormLayer(m.data(), s.data());
+        plain.addWGLayer(3, w.data(), b.data());
+        for (auto net : {&a, &c})
+        {
+            net->addNormLayer(m.data(), s.data());
+            net->addWGLayer(3, W, B, Wp);
+            net->opt_level(NN::OPTLEVEL::FOLD);
+        }
+        plain.init();
+        a.init();
+        c.init();
+        bool untouched = std::equal(w.begin(), w.end(), W.get()) && std::equal(b.begin(), b.end(), B.get())
+                         && std::equal(wp.begin(), wp.end(), Wp.get());
+        float err = 0;
+        for (int n = 0; n < 20; n++)
+        {
+            auto x = random(4);
+            for (auto net : {&plain, &a, &c})
+            {
+                net->copy2input(x.data());
+                net->compute();
+            }
+            for (size_t i = 0; i < 3; i++)
+                err = std::max({err, std::fabs(a.getOutput()[i]-plain.getOutput()[i]), std::fabs(c.getOutput()[i]-plain.getOutput()[i])});
+        }
+        std::cout << "Pesos compartidos: " << (untouched ? "intactos" : "modificados") << ", ";
+        ok &= check("dos redes plegadas", err, c.rewrites(), {"fold Normalize[0] into WG[1]"}, c.n_layers(), 1) && untouched;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+/* Ejemplo: pesos de WG guardados en fp16/bf16 con cálculo en float */
+
+#include "./NNLib/NNLib.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+NN::Net<float> irisNet(NN::WeightFormat fmt)
+{
+    NN::Net<float> net(4);
+    net.addNormLayer("./data/means.csv", "./data/sd.csv");
+    net.addWGLayer(8, "./data/w1.csv", "./data/b1.csv", fmt);
+    net.addReLuLayer();
+    net.addWGLayer(3, "./data/w2.csv", "./data/b2.csv", fmt);
+    net.addSoftMaxLayer();
+    net.init();
+    return net;
+}
+
+int main(int argc, char const *argv[])
+{
+    auto net = irisNet(NN::WeightFormat::NATIVE);
+    const char* names[] = {"float", "fp16", "bf16"};
+    float y[150][3], yh[150][3];
+    net.computeBatch(&data[0][0], &y[0][0], 150);
+
+    bool ok = true;
+    for (auto fmt : {NN::WeightFormat::FP16, NN::WeightFormat::BF16})
+    {
+        auto hnet = irisNet(fmt);
+        hnet.computeBatch(&data[0][0], &yh[0][0], 150);
+        float err = 0;
+        int same = 0;
+        for (size_t i = 0; i < 150; i++)
+        {
+            for (size_t j = 0; j < 3; j++)
+                err = std::max(err, std::fabs(y[i][j]-yh[i][j]));
+            same += std::max_element(y[i], y[i]+3)-y[i] == std::max_element(yh[i], yh[i]+3)-yh[i];
+        }
+        std::cout << "Iris " << names[int(fmt)] << ": " << same << "/150 iguales a float, error max " << err << std::endl;
+        ok = ok && same == 150;
+    }
+
+    // Capa grande con lote 1: limitada por la lectura de los pesos
+    const size_t R = 2048, C = 2048;
+    std::mt19937 gen(3);
+    std::normal_distribution<float> dist(0.0f, 0.05f);
+    std::vector<float> W(R*C), B(R), x(C);
+    for (auto &v : W) v = dist(gen);
+    for (auto &v : B) v = dist(gen);
+    for (auto &v : x) v = dist(gen);
+    for (auto fmt : {NN::WeightFormat::NATIVE, NN::WeightFormat::FP16, NN::WeightFormat::BF16})
+    {
+        NN::Net<float> big(C);
+        big.addWGLayer(R, W.data(), B.data(), fmt);
+        big.init();
+        big.copy2input(x.data());
+        auto t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < 100; k++)
+            big.compute();
+        auto t1 = std::chrono::steady_clock::now();
+        std::cout << "2048x2048 " << names[int(fmt)] << ": " << std::chrono::duration<double, std::micro>(t1-t0).count()/100 << " us" << std::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/* Ejemplo: GEMV, GEMM y GEMV fp16/bf16 con cada conjunto de instrucciones frente a la referencia escalar */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <limits>
+
+/* Cota de la cabecera de NNKernels: |y_simd - y_ref| <= 2*cols*eps*sum|w_j*x_j|
+   (el sesgo cuenta como un término más). */
+template<typename T>
+bool within(const T* W, const T* B, const T* x, const T* y, const T* ref, size_t rows, size_t cols)
+{
+    const T eps = std::numeric_limits<T>::epsilon();
+    for (size_t i = 0; i < rows; i++)
+    {
+        T mag = std::abs(B[i]);
+        for (size_t j = 0; j < cols; j++)
+            mag += std::abs(W[i*cols+j]*x[j]);
+        if (std::abs(y[i]-ref[i]) > 2*(cols+1)*eps*mag)
+            return false;
+    }
+    return true;
+}
+
+// Tamaños impares para pasar también por las colas de cada versión vectorial
+template<typename T>
+bool check(std::mt19937 &gen)
+{
+    std::uniform_real_distribution<T> dist(-1, 1);
+    bool ok = true;
+    for (size_t rows : {1, 7, 37})
+        for (size_t cols : {1, 3, 15, 17, 63, 257})
+        {
+            const size_t n = 9;
+            std::vector<T> W(rows*cols), B(rows), X(n*cols), Wp(NN::kernels::packedSize<T>(rows, cols));
+            for (auto &v : W) v = dist(gen);
+            for (auto &v : B) v = dist(gen);
+            for (auto &v : X) v = dist(gen);
+            NN::kernels::packWeights(W.data(), rows, cols, Wp.data());
+            for (auto ep : {NN::Epilogue::NONE, NN::Epilogue::RELU})
+            {
+                std::vector<T> ref(n*rows), y(rows), Y(n*rows);
+                for (size_t s = 0; s < n; s++)
+                    NN::kernels::gemvRef(W.data(), B.data(), X.data()+s*cols, ref.data()+s*rows, rows, cols, ep);
+                NN::kernels::gemm(Wp.data(), B.data(), X.data(), Y.data(), n, rows, cols, ep);
+                for (size_t s = 0; s < n; s++)
+                {
+                    NN::kernels::gemv(W.data(), B.data(), X.data()+s*cols, y.data(), rows, cols, ep);
+                    ok = ok && within(W.data(), B.data(), X.data()+s*cols, y.data(), ref.data()+s*rows, rows, cols)
+                            && within(W.data(), B.data(), X.data()+s*cols, Y.data()+s*rows, ref.data()+s*rows, rows, cols);
+                }
+            }
+        }
+    return ok;
+}
+
+bool checkHalf(std::mt19937 &gen)
+{
+    std::uniform_real_distribution<float> dist(-1, 1);
+    bool ok = true;
+    for (auto fmt : {NN::WeightFormat::FP16, NN::WeightFormat::BF16})
+        for (size_t cols : {1, 7, 15, 17, 33, 257})
+        {
+            const size_t rows = 13;
+            std::vector<float> W(rows*cols), B(rows), x(cols), Wh(rows*cols), y(rows), ref(rows);
+            std::vector<uint16_t> H(rows*cols);
+            for (auto &v : W) v = dist(gen);
+            for (auto &v : B) v = dist(gen);
+            for (auto &v : x) v = dist(gen);
+            NN::kernels::toHalf(W.data(), H.data(), H.size(), fmt);
+            for (size_t i = 0; i < H.size(); i++)
+                Wh[i] = NN::kernels::fromHalf(H[i], fmt); // Los pesos que ve realmente el núcleo
+            NN::kernels::gemvHalfRef(H.data(), fmt, B.data(), x.data(), ref.data(), rows, cols, NN::Epilogue::NONE);
+            NN::kernels::gemvHalf(H.data(), fmt, B.data(), x.data(), y.data(), rows, cols);
+            ok = ok && within(Wh.data(), B.data(), x.data(), y.data(), ref.data(), rows, cols);
+        }
+    return ok;
+}
+
+int main(int argc, char const *argv[])
+{
+    using NN::kernels::ISA;
+    std::mt19937 gen(3);
+    const ISA best = NN::kernels::detectISA();
+    const ISA saved = NN::kernels::activeISA();
+    bool ok = true;
+    for (ISA isa : {ISA::SCALAR, ISA::SSE42, ISA::AVX2, ISA::AVX512})
+    {
+        if (isa > best)
+        {
+            std::cout << NN::kernels::isaName(isa) << ": no disponible" << std::endl;
+            continue;
+        }
+        NN::kernels::setISA(isa);
+        bool f = check<float>(gen);
+        bool d = check<double>(gen);
+        bool h = checkHalf(gen);
+        std::cout << NN::kernels::isaName(NN::kernels::activeISA()) << ": float " << (f ? "ok" : "FALLO")
+                  << ", double " << (d ? "ok" : "FALLO") << ", fp16/bf16 " << (h ? "ok" : "FALLO") << std::endl;
+        ok = ok && f && d && h && NN::kernels::activeISA() == isa;
+    }
+    NN::kernels::setISA(saved);
+    return ok ? 0 : 1;
+}
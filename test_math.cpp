@@ -0,0 +1,169 @@
+/* Ejemplo: precisión de exp, sigmoide y softmax (NNMath) en cada modo y con cada conjunto de instrucciones */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <limits>
+
+// Referencia con más precisión que T
+template<typename T> using Wide = typename std::conditional<sizeof(T) == 4, double, long double>::type;
+
+// Distancia en ulp de T entre y y el valor exacto ref
+template<typename T>
+double ulps(T y, Wide<T> ref)
+{
+    T r = T(ref);
+    T ulp = std::nextafter(r, std::numeric_limits<T>::infinity()) - r;
+    return double(std::fabs(Wide<T>(y) - ref)/ulp);
+}
+
+// Barrido de [lo, hi] con un poco de ruido, en trozos de longitud 1..37 para pasar por las colas vectoriales
+template<typename T>
+std::vector<T> sweep(T lo, T hi, size_t n, std::mt19937 &gen)
+{
+    std::uniform_real_distribution<double> jitter(-0.5, 0.5);
+    std::vector<T> x(n);
+    const double step = (double(hi)-double(lo))/(n-1);
+    for (size_t i = 0; i < n; i++)
+        x[i] = T(std::min(double(hi), std::max(double(lo), double(lo) + (i + (i && i+1 < n ? jitter(gen) : 0))*step)));
+    return x;
+}
+
+template<typename F>
+void chunked(size_t n, F f)
+{
+    for (size_t i = 0, c = 0; i < n; c++)
+    {
+        size_t len = std::min(n-i, 1 + c % 37);
+        f(i, len);
+        i += len;
+    }
+}
+
+template<typename T>
+bool check(const char* type, std::mt19937 &gen)
+{
+    using C = NN::kernels::ExpConst<T>;
+    using NN::ActMode;
+    const size_t N = 200001;
+    const std::vector<T> x = sweep<T>(C::lo, C::hi, N, gen);
+    std::vector<T> y(N);
+    bool ok = true;
+
+    // exp: EXACT es std::exp, FAST < 2 ulp, LUT relativo < 3e-7
+    double exact = 0, fast = 0, lut = 0;
+    for (ActMode mode : {ActMode::EXACT, ActMode::FAST, ActMode::LUT})
+    {
+        chunked(N, [&](size_t i, size_t len){NN::kernels::vexp(x.data()+i, y.data()+i, len, mode);});
+        for (size_t i = 0; i < N; i++)
+        {
+            const Wide<T> ref = std::exp(Wide<T>(x[i]));
+            if (mode == ActMode::EXACT)
+                exact = std::max(exact, double(y[i] != std::exp(x[i])));
+            else if (mode == ActMode::FAST)
+                fast = std::max(fast, ulps(y[i], ref));
+            else
+                lut = std::max(lut, double(std::fabs(Wide<T>(y[i]) - ref)/ref));
+        }
+    }
+    std::cout << "  " << type << " exp: FAST " << fast << " ulp, LUT " << lut << " relativo" << std::endl;
+    ok = ok && exact == 0 && fast < 2 && lut < 3e-7;
+
+    // Sigmoide: LUT absoluto < 3e-6; FAST usa la misma exp, se comprueba con la misma cota absoluta que EXACT
+    double sfast = 0, slut = 0, sexact = 0;
+    for (ActMode mode : {ActMode::EXACT, ActMode::FAST, ActMode::LUT})
+    {
+        chunked(N, [&](size_t i, size_t len){NN::kernels::sigmoid(x.data()+i, y.data()+i, len, mode);});
+        for (size_t i = 0; i < N; i++)
+        {
+            const double err = double(std::fabs(Wide<T>(y[i]) - 1/(1+std::exp(-Wide<T>(x[i])))));
+            double &e = mode == ActMode::EXACT ? sexact : mode == ActMode::FAST ? sfast : slut;
+            e = std::max(e, err);
+        }
+    }
+    const double eps = std::numeric_limits<T>::epsilon();
+    std::cout << "  " << type << " sigmoide: EXACT " << sexact << ", FAST " << sfast << ", LUT " << slut << " absoluto" << std::endl;
+    ok = ok && sexact < 2*eps && sfast < 2*eps && slut < 3e-6;
+
+    // Softmax con longitudes impares y entradas grandes (se resta el máximo)
+    std::uniform_real_distribution<T> dist(-20, 20);
+    double smax[3] = {0, 0, 0};
+    for (size_t n : {1, 3, 17, 33, 1001})
+        for (T offset : {T(0), T(500)})
+        {
+            std::vector<T> in(n), out(n);
+            for (auto &v : in) v = dist(gen) + offset;
+            Wide<T> max = *std::max_element(in.begin(), in.end()), sum = 0;
+            for (auto v : in) sum += std::exp(Wide<T>(v) - max);
+            for (ActMode mode : {ActMode::EXACT, ActMode::FAST, ActMode::LUT})
+            {
+                bool ret = NN::kernels::softmax(in.data(), out.data(), n, mode);
+                for (size_t i = 0; i < n; i++)
+                {
+                    const Wide<T> ref = std::exp(Wide<T>(in[i]) - max)/sum;
+                    double &e = smax[int(mode)];
+                    e = std::max(e, ret ? double(std::fabs(Wide<T>(out[i]) - ref)/ref) : 1.0);
+                }
+            }
+        }
+    // Error de exp más la suma de n términos y la división
+    std::cout << "  " << type << " softmax: EXACT " << smax[0] << ", FAST " << smax[1] << ", LUT " << smax[2] << " relativo" << std::endl;
+    ok = ok && smax[0] < 1004*eps && smax[1] < 1006*eps && smax[2] < 3e-7 + 1004*eps;
+
+    // NaN en el cuerpo vectorial y en la cola: sale NaN solo en su posición y softmax lo rechaza
+    const T nan = std::numeric_limits<T>::quiet_NaN();
+    std::vector<T> in(37), clean(37), out(37), ref(37);
+    for (size_t i = 0; i < in.size(); i++)
+        in[i] = clean[i] = dist(gen);
+    for (size_t i : {0, 5, 20, 36})
+        in[i] = nan;
+    bool nan_ok = true;
+    for (ActMode mode : {ActMode::EXACT, ActMode::FAST, ActMode::LUT})
+    {
+        for (bool sig : {false, true})
+        {
+            if (sig)
+            {
+                NN::kernels::sigmoid(in.data(), out.data(), in.size(), mode);
+                NN::kernels::sigmoid(clean.data(), ref.data(), clean.size(), mode);
+            }
+            else
+            {
+                NN::kernels::vexp(in.data(), out.data(), in.size(), mode);
+                NN::kernels::vexp(clean.data(), ref.data(), clean.size(), mode);
+            }
+            for (size_t i = 0; i < in.size(); i++)
+                nan_ok = nan_ok && (std::isnan(in[i]) ? std::isnan(out[i]) : out[i] == ref[i]);
+        }
+        nan_ok = nan_ok && !NN::kernels::softmax(in.data(), out.data(), in.size(), mode);
+    }
+    std::cout << "  " << type << " NaN: " << (nan_ok ? "se propaga" : "FALLO") << std::endl;
+    return ok && nan_ok;
+}
+
+int main(int argc, char const *argv[])
+{
+    using NN::kernels::ISA;
+    std::mt19937 gen(19);
+    const ISA best = NN::kernels::detectISA();
+    const ISA saved = NN::kernels::activeISA();
+    bool ok = true;
+    for (ISA isa : {ISA::SCALAR, ISA::SSE42, ISA::AVX2, ISA::AVX512})
+    {
+        if (isa > best)
+        {
+            std::cout << NN::kernels::isaName(isa) << ": no disponible" << std::endl;
+            continue;
+        }
+        NN::kernels::setISA(isa);
+        std::cout << NN::kernels::isaName(isa) << ":" << std::endl;
+        bool f = check<float>("float", gen);
+        bool d = check<double>("double", gen);
+        std::cout << (f && d ? "  ok" : "  FALLO") << std::endl;
+        ok = ok && f && d;
+    }
+    NN::kernels::setISA(saved);
+    return ok ? 0 : 1;
+}
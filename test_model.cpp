@@ -0,0 +1,53 @@
+/* Ejemplo: un modelo compartido por varios hilos */
+
+#include "./NNLib/NNModel.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+#include <thread>
+
+#define N_THREADS 8
+
+float res_net[150][3];
+float res_threads[N_THREADS][150][3];
+
+int main(int argc, char const *argv[])
+{
+    auto net = NN::loadNet<float>("./data/nn1.toml");
+    net.init();
+    net.computeBatch(data[0], res_net[0], 150);
+
+    // Los pesos se comparten; cada hilo tiene su contexto
+    auto model = NN::Model<float>::create(net);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < N_THREADS; t++)
+    {
+        workers.emplace_back([&model, t](){
+            NN::ExecutionContext<float> ctx(model);
+            for (size_t i = 0; i < 150; i++)
+            {
+                ctx.copy2input(data[i]);
+                ctx.compute();
+                ctx.copyout(res_threads[t][i]);
+            }
+        });
+    }
+    for (auto &w : workers)
+        w.join();
+
+    // La copia de una red es independiente del original
+    NN::Net<float> copy(net);
+    net.getInput()[0] = 1e6f;
+    copy.copy2input(data[0]);
+    copy.compute();
+
+    float max_err = 0;
+    for (size_t t = 0; t < N_THREADS; t++)
+        for (size_t i = 0; i < 150; i++)
+            for (size_t j = 0; j < 3; j++)
+                max_err = std::max(max_err, std::abs(res_threads[t][i][j]-res_net[i][j]));
+    for (size_t j = 0; j < 3; j++)
+        max_err = std::max(max_err, std::abs(copy.getOutput()[j]-res_net[0][j]));
+    std::cout << "Error máximo hilos vs red: " << max_err << std::endl;
+
+    return max_err < 1e-5f ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+/* Ejemplo de inferencia en paralelo de un lote grande */
+
+#include "./NNLib/NNLib.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+#include <cstring>
+#include <chrono>
+
+#define N_SAMPLES 150000
+
+int main(int argc, char const *argv[])
+{
+    auto net = NN::loadNet<float>("./data/nn1.toml");
+    net.init();
+
+    // Lote grande a partir de las muestras de iris
+    std::vector<float> in(N_SAMPLES*4), out_seq(N_SAMPLES*3), out_par(N_SAMPLES*3);
+    for (size_t i = 0; i < N_SAMPLES; i++)
+        std::copy(data[i%150], data[i%150]+4, &in[i*4]);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < N_SAMPLES; i++)
+    {
+        net.copy2input(&in[i*4]);
+        net.compute();
+        net.copyout(&out_seq[i*3]);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    net.computeParallel(in.data(), out_par.data(), N_SAMPLES);
+    auto t2 = std::chrono::steady_clock::now();
+
+    std::cout << "Secuencial: " << std::chrono::duration<double, std::milli>(t1-t0).count() << " ms" << std::endl;
+    std::cout << "Paralelo:   " << std::chrono::duration<double, std::milli>(t2-t1).count() << " ms ("
+              << NN::defaultThreadPool().size() << " hilos)" << std::endl;
+
+    bool same = std::memcmp(out_seq.data(), out_par.data(), out_seq.size()*sizeof(float)) == 0;
+    std::cout << (same ? "Resultados idénticos" : "Resultados distintos") << std::endl;
+    return same ? 0 : 1;
+}
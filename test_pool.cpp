@@ -0,0 +1,164 @@
+/* Ejemplo: MaxPool/AvgPool y fusión Conv->Pool en Net::init() */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+// Referencia: pooling sin relleno
+std::vector<float> pool(const float* in, const NN::PoolParams &p, NN::PoolMode mode)
+{
+    const NN::dim_t o = p.output();
+    std::vector<float> out(p.outputLen());
+    for (size_t r = 0; r < o.rows; r++)
+        for (size_t c = 0; c < o.cols; c++)
+        {
+            float acc = mode == NN::PoolMode::MAX ? -INFINITY : 0;
+            for (size_t i = 0; i < p.size.rows; i++)
+                for (size_t j = 0; j < p.size.cols; j++)
+                {
+                    float v = in[(r*p.stride.rows+i)*p.input.cols + c*p.stride.cols+j];
+                    acc = mode == NN::PoolMode::MAX ? std::max(acc, v) : acc + v;
+                }
+            out[r*o.cols+c] = mode == NN::PoolMode::MAX ? acc : acc/(p.size.rows*p.size.cols);
+        }
+    return out;
+}
+
+float maxError(const float* a, const float* b, size_t n)
+{
+    float err = 0;
+    for (size_t i = 0; i < n; i++)
+        err = std::max(err, std::fabs(a[i]-b[i]));
+    return err;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    bool ok = true;
+
+    // Capas sueltas
+    NN::PoolParams p;
+    p.input = NN::dim_t(37, 23);
+    for (NN::dim_t size : {NN::dim_t(2, 2), NN::dim_t(3, 2)})
+        for (NN::dim_t stride : {NN::dim_t(2, 2), NN::dim_t(1, 1)})
+        {
+            p.size = size;
+            p.stride = stride;
+            NN::MaxPoolLayer<float> maxp(p);
+            NN::AvgPoolLayer<float> avgp(p);
+            for (size_t i = 0; i < p.inputLen(); i++)
+                maxp.getMutInputBlock()[i] = avgp.getMutInputBlock()[i] = dist(gen);
+            maxp.compute();
+            avgp.compute();
+            float err = std::max(maxError(maxp.getOutputBlock(), pool(maxp.getInputBlock(), p, NN::PoolMode::MAX).data(), p.outputLen()),
+                                 maxError(avgp.getOutputBlock(), pool(avgp.getInputBlock(), p, NN::PoolMode::AVG).data(), p.outputLen()));
+            std::cout << "Pool " << size.cols << "x" << size.rows << " paso " << stride.cols << ": error max " << err << std::endl;
+            ok = ok && err <= 1e-6f;
+        }
+
+    // Conv -> Pool 2x2 en una red: la convolución escribe directamente la salida reducida
+    const NN::dim_t dim{320, 200};
+    const size_t len = size_t(dim.rows)*dim.cols;
+    std::vector<float> image(len), k(31*31);
+    for (auto &v : image) v = dist(gen);
+    for (auto &v : k) v = dist(gen)/31;
+    std::vector<float> gauss(7*7);
+    for (size_t i = 0; i < 7; i++)
+        for (size_t j = 0; j < 7; j++)
+            gauss[i*7+j] = std::exp(-(float((i-3)*(i-3)) + float((j-3)*(j-3)))/4.5f)/16;
+
+    struct Case {const char* name; NN::dim_t kdim; float* data; NN::ConvMethod method;};
+    Case cases[] = {
+        {"3x3 directa", {3, 3}, k.data(), NN::ConvMethod::AUTO},
+        {"3x3 Winograd", {3, 3}, k.data(), NN::ConvMethod::WINOGRAD_4X4},
+        {"7x7 separable", {7, 7}, gauss.data(), NN::ConvMethod::AUTO},
+        {"31x31 FFT", {31, 31}, k.data(), NN::ConvMethod::AUTO},
+    };
+    NN::PoolParams p2;
+    p2.input = dim;
+    for (auto &c : cases)
+    {
+        for (auto mode : {NN::PoolMode::MAX, NN::PoolMode::AVG})
+        {
+            NN::Net<float> net(len);
+            net.addConvLayer(dim, {c.kdim, c.data}, NN::ConvPadding::SAME);
+            std::dynamic_pointer_cast<NN::ConvLayer<float>>(net.tail())->setMethod(c.method);
+            net.addPoolLayer(p2, mode);
+            net.init();
+            net.copy2input(image.data());
+            net.compute();
+
+            // Sin fusión: convolución completa y pooling por separado
+            NN::ConvLayer<float> conv(dim);
+            std::copy(image.begin(), image.end(), conv.getMutInputBlock());
+            conv.setKernel({c.kdim, c.data});
+            conv.setMethod(c.method);
+            conv.setPadding(NN::ConvPadding::SAME);
+            conv.compute();
+            auto ref = pool(conv.getOutputBlock(), p2, mode);
+
+            std::vector<float> batch(2*p2.outputLen()), in2(2*len);
+            std::copy(image.begin(), image.end(), in2.begin());
+            std::copy(image.begin(), image.end(), in2.begin()+len);
+            net.computeBatch(in2.data(), batch.data(), 2);
+
+            float err = std::max({maxError(net.getOutput(), ref.data(), ref.size()),
+                                  maxError(batch.data(), ref.data(), ref.size()),
+                                  maxError(batch.data()+ref.size(), ref.data(), ref.size())});
+
+            auto t0 = std::chrono::steady_clock::now();
+            for (int n = 0; n < 20; n++)
+                net.compute();
+            auto t1 = std::chrono::steady_clock::now();
+            NN::MaxPoolLayer<float> sep(&conv, p2);
+            for (int n = 0; n < 20; n++)
+            {
+                conv.compute();
+                sep.compute();
+            }
+            auto t2 = std::chrono::steady_clock::now();
+            std::cout << c.name << (mode == NN::PoolMode::MAX ? " + MaxPool" : " + AvgPool") << (net.layer(1)->fused() ? " (fusionada)" : "")
+                      << ": error max " << err << ", fusionada " << std::chrono::duration<double, std::milli>(t1-t0).count()/20
+                      << " ms, por separado " << std::chrono::duration<double, std::milli>(t2-t1).count()/20 << " ms" << std::endl;
+            ok = ok && net.layer(1)->fused() && net.getOutputSize() == p2.outputLen() && err <= 1e-5f;
+        }
+    }
+
+    // Misma longitud pero otra forma (20x10 frente a 10x20): se rechaza y no se fusiona
+    {
+        NN::Net<float> bad(200);
+        std::vector<float> k3(9, 1.0f);
+        bad.addConvLayer(NN::dim_t(20, 10), {{3, 3}, k3.data()});
+        NN::PoolParams pb;
+        pb.input = NN::dim_t(10, 20);
+        bad.addPoolLayer(pb);
+        bool thrown = false;
+        try
+        {
+            bad.init();
+        }
+        catch(const NN::NetError &e)
+        {
+            thrown = true;
+        }
+        std::cout << "Conv 20x10 -> Pool 10x20: " << (thrown ? "rechazada" : "aceptada") << std::endl;
+        ok = ok && thrown && bad.layer(1)->code() != NN::OPCODE::OK && !bad.layer(1)->fused();
+    }
+
+    // Desde el .toml
+    auto net = NN::loadNet<float>("./data/pool.toml");
+    net.init();
+    for (size_t i = 0; i < 36; i++)
+        net.getInput()[i] = float(i);
+    net.compute();
+    const float expected[4] = {14, 16, 26, 28}; // Máximos 2x2: 7 9 11 / 19 21 23 / 31 33 35, luego medias 2x2 con paso 1
+    float err = maxError(net.getOutput(), expected, 4);
+    std::cout << "pool.toml: error max " << err << std::endl;
+    ok = ok && net.getOutputSize() == 4 && err == 0;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/* Ejemplo: perfilado por capa de Net (setProfiling, profile()) */
+
+#include "./NNLib/NNLib.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+float res[150][3];
+
+// Pasa las 150 muestras una a una y devuelve los ns por pasada
+double run(NN::Net<float> &net, size_t reps)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; r++)
+        for (size_t i = 0; i < 150; i++)
+        {
+            net.copy2input(data[i]);
+            net.compute();
+        }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count()/(150*reps);
+}
+
+int main(int argc, char const *argv[])
+{
+    bool ok = true;
+
+    // Percentiles del histograma: 1..1000 µs
+    NN::LayerStats st;
+    for (uint64_t v = 1; v <= 1000; v++)
+        st.record(v*1000);
+    double p50 = st.percentile(0.5), p99 = st.percentile(0.99);
+    std::cout << "1..1000 µs: media " << st.mean()*1e-3 << ", p50 " << p50*1e-3 << ", p99 " << p99*1e-3 << std::endl;
+    ok = ok && st.min() == 1000 && st.max() == 1000000 && std::fabs(st.mean()-500500) < 1
+            && std::fabs(p50/500000-1) < 0.06 && std::fabs(p99/990000-1) < 0.06;
+
+    auto net = NN::loadNet<float>("./data/nn1.toml");
+    net.init();
+    net.setProfiling(true);
+    for (size_t i = 0; i < 150; i++)
+    {
+        net.copy2input(data[i]);
+        net.compute();
+    }
+    std::cout << net.profile();
+    const auto &prof = net.profile();
+    ok = ok && prof.size() == net.n_layers() && prof.net().count() == 150;
+    for (size_t k = 0; k < prof.size(); k++)
+    {
+        const auto &l = prof[k];
+        ok = ok && prof.id(k) == net.layer(k)->id() && prof.fused(k) == net.layer(k)->fused();
+        if (prof.fused(k))
+            continue;
+        ok = ok && l.count() == 150
+                && l.min() <= l.mean() && l.mean() <= l.max()
+                && l.percentile(0.99) >= l.min() && l.percentile(0.99) <= l.max();
+    }
+
+    // Por lotes: una medida por capa y bloque de NN_BATCH_TILE muestras, repartida entre ellas (tiempos por muestra)
+    net.clearProfile();
+    net.computeBatch(data[0], res[0], 150);
+    std::cout << "computeBatch(150): " << prof[0].count() << " muestras en la capa 0, " << prof.net().count() << " en la red, media "
+              << prof.net().mean() << " ns por muestra" << std::endl;
+    ok = ok && prof[0].count() == 150 && prof.net().count() == 150;
+    for (size_t k = 0; k < prof.size(); k++)
+        ok = ok && (prof.fused(k) || (prof[k].min() <= prof[k].mean() && prof[k].mean() <= prof[k].max()));
+
+    // Muestreo: una de cada 10 pasadas
+    net.clearProfile();
+    net.setProfiling(true, 10);
+    run(net, 1);
+    std::cout << "Muestreo 1/10: " << prof.net().count() << " pasadas perfiladas de 150" << std::endl;
+    ok = ok && prof.net().count() == 15;
+
+    // Coste: apagado, muestreado y siempre
+    net.setProfiling(false);
+    double off = run(net, 200);
+    net.setProfiling(true, 100);
+    double sampled = run(net, 200);
+    net.setProfiling(true);
+    double on = run(net, 200);
+    std::cout << "ns por pasada: sin perfilar " << off << ", 1/100 " << sampled << ", siempre " << on << std::endl;
+
+    // Una capa fusionada no se mide
+    NN::Net<float> conv(64);
+    std::vector<float> k(9, 1.0f/9);
+    NN::PoolParams p;
+    p.input = NN::dim_t(8, 8);
+    conv.addConvLayer(p.input, {{3, 3}, k.data()});
+    conv.addPoolLayer(p);
+    conv.init();
+    conv.setProfiling(true);
+    conv.compute();
+    std::cout << conv.profile();
+    ok = ok && conv.profile().fused(1) && conv.profile()[1].count() == 0 && conv.profile()[0].count() == 1;
+
+    return ok ? 0 : 1;
+}
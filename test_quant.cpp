@@ -0,0 +1,89 @@
+/* Ejemplo: la red de iris con capas WG cuantizadas a int8 frente a la original */
+
+#include "./NNLib/NNLib.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+template<typename T>
+size_t argmax(const T* v, size_t n)
+{
+    return std::max_element(v, v+n) - v;
+}
+
+int main(int argc, char const *argv[])
+{
+    auto net = NN::loadNet<float>("./data/nn1.toml");
+    net.init();
+
+    NN::Net<float> qnet(4);
+    qnet.addNormLayer("./data/means.csv", "./data/sd.csv");
+    qnet.addQuantWGLayer(8, "./data/w1.csv", "./data/b1.csv");
+    qnet.addReLuLayer();
+    qnet.addQuantWGLayer(3, "./data/w2.csv", "./data/b2.csv");
+    qnet.addSoftMaxLayer();
+    qnet.init();
+
+    int same = 0, hits = 0;
+    float err = 0;
+    float y[3], yq[3];
+    for (size_t i = 0; i < 150; i++)
+    {
+        net.copy2input(data[i]);
+        net.compute();
+        net.copyout(y);
+        qnet.copy2input(data[i]);
+        qnet.compute();
+        qnet.copyout(yq);
+        for (size_t j = 0; j < 3; j++)
+            err = std::max(err, std::fabs(y[j]-yq[j]));
+        same += argmax(y, 3) == argmax(yq, 3);
+        hits += argmax(expected[i], 3) == argmax(yq, 3);
+    }
+    std::cout << "Iris int8: " << hits << "/150 aciertos, " << same << "/150 iguales a float, error max " << err << std::endl;
+
+    // Capa grande: mismo resultado con todos los núcleos, y tiempo frente a float
+    const size_t R = 1024, C = 1024;
+    std::mt19937 gen(7);
+    std::normal_distribution<float> dist(0.0f, 0.05f);
+    std::vector<float> W(R*C), B(R), x(C), yf(R), yr(R), ys(R);
+    for (auto &v : W) v = dist(gen);
+    for (auto &v : B) v = dist(gen);
+    for (auto &v : x) v = 20*dist(gen);
+
+    NN::Net<float> big(C), qbig(C);
+    big.addWGLayer(R, W.data(), B.data());
+    qbig.addQuantWGLayer(R, W.data(), B.data());
+    big.init();
+    qbig.init();
+
+    auto run = [&](NN::Net<float> &n, float* out){
+        n.copy2input(x.data());
+        auto t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < 200; k++)
+            n.compute();
+        auto t1 = std::chrono::steady_clock::now();
+        n.copyout(out);
+        return std::chrono::duration<double, std::micro>(t1-t0).count()/200;
+    };
+    double tf = run(big, yf.data());
+    double tq = run(qbig, yr.data());
+    NN::kernels::ISA isa = NN::kernels::activeISA();
+    NN::kernels::setISA(NN::kernels::ISA::SCALAR);
+    run(qbig, ys.data());
+    NN::kernels::setISA(isa);
+
+    float rel = 0, norm = 0;
+    for (size_t i = 0; i < R; i++)
+    {
+        rel = std::max(rel, std::fabs(yf[i]-yr[i]));
+        norm = std::max(norm, std::fabs(yf[i]));
+    }
+    bool exact = yr == ys;
+    std::cout << "1024x1024: float " << tf << " us, int8 " << tq << " us, error max relativo " << rel/norm
+              << (exact ? ", SIMD == escalar" : ", SIMD != escalar") << std::endl;
+    return (same >= 145 && exact && rel/norm < 0.05f) ? 0 : 1;
+}
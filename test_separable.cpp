@@ -0,0 +1,78 @@
+/* Ejemplo: kernels separables (gaussiano, Sobel, caja) en dos pasadas 1D */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+std::vector<float> gaussian(size_t k, float sigma)
+{
+    std::vector<float> g(k), out(k*k);
+    float sum = 0;
+    for (size_t i = 0; i < k; i++)
+        sum += g[i] = std::exp(-std::pow(float(i)-float(k/2), 2.0f)/(2*sigma*sigma));
+    for (size_t i = 0; i < k; i++)
+        for (size_t j = 0; j < k; j++)
+            out[i*k+j] = g[i]*g[j]/(sum*sum);
+    return out;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> sobel = {-1, 0, 1, -2, 0, 2, -1, 0, 1};
+    std::vector<float> box(25, 1.0f/25);
+    std::vector<float> noise(25);
+    for (auto &v : noise) v = dist(gen);
+
+    struct Case {const char* name; NN::dim_t dim; std::vector<float> k; bool separable;};
+    Case cases[] = {
+        {"Sobel 3x3", {3, 3}, sobel, true},
+        {"Caja 5x5", {5, 5}, box, true},
+        {"Gauss 7x7", {7, 7}, gaussian(7, 1.5f), true},
+        {"Gauss 11x11", {11, 11}, gaussian(11, 2.5f), true},
+        {"Aleatorio 5x5", {5, 5}, noise, false},
+    };
+
+    const NN::dim_t dim{320, 200};
+    const size_t len = size_t(dim.rows)*dim.cols;
+    bool ok = true;
+    for (auto &c : cases)
+    {
+        NN::ConvLayer<float> ref(dim), sep(dim);
+        for (size_t i = 0; i < len; i++)
+            ref.getMutInputBlock()[i] = sep.getMutInputBlock()[i] = dist(gen);
+        ref.setMethod(NN::ConvMethod::DIRECT);
+        ref.setKernel({c.dim, c.k.data()});
+        sep.setMethod(NN::ConvMethod::SEPARABLE);
+        sep.setKernel({c.dim, c.k.data()});
+
+        float err = 0, ksum = 0;
+        for (auto padding : {NN::ConvPadding::VALID, NN::ConvPadding::SAME})
+        {
+            ref.setPadding(padding);
+            sep.setPadding(padding);
+            ref.compute();
+            sep.compute();
+            for (size_t i = 0; i < len; i++)
+                err = std::max(err, std::fabs(ref.getOutputBlock()[i]-sep.getOutputBlock()[i]));
+        }
+        for (auto v : c.k) ksum += std::fabs(v);
+
+        auto time = [&](NN::ConvLayer<float> &conv){
+            auto t0 = std::chrono::steady_clock::now();
+            for (int k = 0; k < 50; k++)
+                conv.compute();
+            auto t1 = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::milli>(t1-t0).count()/50;
+        };
+        double td = time(ref), ts = time(sep);
+        std::cout << c.name << ": " << (sep.separable() ? "separable" : "no separable") << ", error max " << err
+                  << ", directa " << td << " ms, " << (sep.separable() ? "separable " : "sin cambio ") << ts << " ms" << std::endl;
+        ok = ok && sep.separable() == c.separable && err <= 1e-5f*ksum;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+/* Ejemplo de red con topología fija en tiempo de compilación */
+
+#include "./NNLib/NNLib.hpp"
+#include "./NNLib/NNStatic.hpp"
+#include "./data/iris.hpp" // data[150][4] y expected[150][3]
+#include <iostream>
+
+using IrisNet = NN::StaticNet<float, NN::Norm<4>, NN::WG<4,8>, NN::ReLu<8>, NN::WG<8,3>, NN::SoftMax<3>>;
+
+int main(int argc, char const *argv[])
+{
+    // Definición y configuración: sin memoria dinámica
+    static IrisNet snet;
+    snet.layer<0>().load("./data/means.csv", "./data/sd.csv");
+    snet.layer<1>().load("./data/w1.csv", "./data/b1.csv");
+    snet.layer<3>().load("./data/w2.csv", "./data/b2.csv");
+
+    // Referencia con la red dinámica
+    auto net = NN::loadNet<float>("./data/nn1.toml");
+    net.init();
+
+    float max_err = 0;
+    for (size_t i = 0; i < 150; i++)
+    {
+        float out_s[3], out_d[3];
+        snet.copy2input(data[i]);
+        snet();
+        snet.copyout(out_s);
+
+        net.copy2input(data[i]);
+        net();
+        net.copyout(out_d);
+
+        for (size_t j = 0; j < 3; j++)
+            max_err = std::max(max_err, std::abs(out_s[j]-out_d[j]));
+    }
+    std::cout << "Capas: " << IrisNet::n_layers() << ", entradas: " << IrisNet::inputs << ", salidas: " << IrisNet::outputs << std::endl;
+    std::cout << "Error máximo StaticNet vs Net: " << max_err << std::endl;
+
+    return max_err < 1e-5f ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/* Ejemplo: convolución 1D en flujo (push) frente a recalcular la ventana completa */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    const size_t len = 32000, kw = 63;
+    std::vector<float> kernel(kw), signal(len);
+    float ksum = 0;
+    for (auto &k : kernel) ksum += std::fabs(k = dist(gen));
+    for (auto &x : signal) x = dist(gen);
+
+    // Referencia: la señal entera de una vez (VALID, salida centrada en kw/2)
+    NN::ConvLayer<float> ref{NN::dim_t(len)};
+    std::copy(signal.begin(), signal.end(), ref.getMutInputBlock());
+    ref.setKernel({{kw}, kernel.data()});
+    ref.compute();
+
+    bool ok = true;
+    for (size_t chunk : {size_t(1), size_t(7), size_t(256), size_t(5000)})
+    {
+        NN::ConvLayer<float> conv{NN::dim_t(chunk)};
+        conv.setKernel({{kw}, kernel.data()});
+        std::vector<float> out;
+        std::vector<float> y(chunk);
+        for (size_t i = 0; i < len; i += chunk)
+        {
+            const size_t n = std::min(chunk, len-i);
+            const size_t m = conv.push(signal.data()+i, n, y.data());
+            out.insert(out.end(), y.begin(), y.begin()+m);
+        }
+        float err = 0;
+        for (size_t t = 0; t < out.size(); t++)
+            err = std::max(err, std::fabs(out[t]-ref.getOutputBlock()[t+kw/2]));
+        std::cout << "Bloques de " << chunk << ": " << out.size() << " salidas, error max " << err << std::endl;
+        ok = ok && out.size() == len-kw+1 && err <= 1e-5f*ksum;
+    }
+
+    // Coste por muestra: push frente a recalcular una ventana de 4096 muestras
+    const size_t chunk = 64, window = 4096;
+    NN::ConvLayer<float> full{NN::dim_t(window)}, stream{NN::dim_t(chunk)};
+    full.setMethod(NN::ConvMethod::DIRECT);
+    full.setKernel({{kw}, kernel.data()});
+    stream.setKernel({{kw}, kernel.data()});
+    for (size_t total : {size_t(1) << 14, size_t(1) << 20})
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < total; i += chunk)
+            stream.push(signal.data() + i % (len-chunk), chunk);
+        auto t1 = std::chrono::steady_clock::now();
+        std::cout << "push, " << total << " muestras: " << std::chrono::duration<double, std::nano>(t1-t0).count()/total << " ns/muestra" << std::endl;
+    }
+    const size_t total = size_t(1) << 14;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < total; i += chunk)
+    {
+        float* in = full.getMutInputBlock();
+        std::copy(in+chunk, in+window, in);
+        std::copy(signal.data() + i % (len-chunk), signal.data() + i % (len-chunk) + chunk, in+window-chunk);
+        full.compute();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "recalcular " << window << ", " << total << " muestras: " << std::chrono::duration<double, std::nano>(t1-t0).count()/total << " ns/muestra" << std::endl;
+    return ok ? 0 : 1;
+}
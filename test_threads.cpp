@@ -0,0 +1,150 @@
+/* Ejemplo: paralelismo dentro de la capa (Net::setThreads) y excepciones en ThreadPool */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <stdexcept>
+#include <atomic>
+
+bool same(const float* a, const float* b, size_t n)
+{
+    return std::memcmp(a, b, n*sizeof(float)) == 0;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(23);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    bool ok = true;
+
+    // WG grande + ReLu: GEMV por filas (compute) y GEMM por paneles (lote)
+    {
+        const size_t si = 1024, so = 512, n = 64;
+        std::vector<float> w(si*so), b(so), in(n*si);
+        for (auto &v : w) v = dist(gen);
+        for (auto &v : b) v = dist(gen);
+        for (auto &v : in) v = dist(gen);
+        NN::Net<float> serial(si), threaded(si);
+        for (auto net : {&serial, &threaded})
+        {
+            net->addWGLayer(so, w.data(), b.data());
+            net->addReLuLayer();
+        }
+        serial.setThreads(1);
+        threaded.setThreads(4);
+        serial.init();
+        threaded.init();
+        serial.copy2input(in.data());
+        threaded.copy2input(in.data());
+        serial.compute();
+        threaded.compute();
+        bool single = same(serial.getOutput(), threaded.getOutput(), so);
+        std::vector<float> out_s(n*so), out_t(n*so);
+        serial.computeBatch(in.data(), out_s.data(), n);
+        threaded.computeBatch(in.data(), out_t.data(), n);
+        bool batch = same(out_s.data(), out_t.data(), n*so);
+        std::cout << "WG " << si << "x" << so << ", 4 hilos: muestra " << (single ? "igual" : "distinta")
+                  << ", lote " << (batch ? "igual" : "distinto") << std::endl;
+        ok = ok && single && batch;
+    }
+
+    // Conv 250x250 por bandas de filas, sola y con MaxPool fusionado
+    {
+        const NN::dim_t dim(250, 250);
+        const size_t len = size_t(dim.rows)*dim.cols;
+        std::vector<float> image(len), k(25);
+        for (auto &v : image) v = dist(gen);
+        for (auto &v : k) v = dist(gen);
+        NN::PoolParams p;
+        p.input = dim;
+        for (bool pool : {false, true})
+        {
+            NN::Net<float> serial(len), threaded(len);
+            for (auto net : {&serial, &threaded})
+            {
+                net->addConvLayer(dim, {{5, 5}, k.data()}, NN::ConvPadding::SAME);
+                if (pool)
+                    net->addPoolLayer(p);
+            }
+            serial.setThreads(1);
+            threaded.setThreads(4);
+            serial.init();
+            threaded.init();
+            serial.copy2input(image.data());
+            threaded.copy2input(image.data());
+            serial.compute();
+            threaded.compute();
+            bool eq = serial.getOutputSize() == threaded.getOutputSize() && same(serial.getOutput(), threaded.getOutput(), serial.getOutputSize());
+            std::cout << "Conv 250x250 5x5" << (pool ? " + MaxPool" : "") << ", 4 hilos: " << (eq ? "igual" : "distinta") << std::endl;
+            ok = ok && eq;
+        }
+    }
+
+    // Una excepción en cualquier trozo llega al llamante y el pool sigue funcionando
+    {
+        NN::ThreadPool pool(4);
+        for (size_t bad : {size_t(0), size_t(500), size_t(999)})
+        {
+            bool caught = false;
+            try
+            {
+                pool.parallel_for(1000, 10, [&](size_t b, size_t e){
+                    if (bad >= b && bad < e)
+                        throw std::runtime_error("trozo");
+                });
+            }
+            catch(const std::runtime_error &e)
+            {
+                caught = true;
+            }
+            std::atomic<size_t> sum{0};
+            pool.parallel_for(1000, 10, [&](size_t b, size_t e){
+                for (size_t i = b; i < e; i++)
+                    sum += i;
+            });
+            std::cout << "Excepción en el elemento " << bad << ": " << (caught ? "recibida" : "perdida") << ", pool " << (sum == 499500 ? "correcto" : "roto") << std::endl;
+            ok = ok && caught && sum == 499500;
+        }
+    }
+    // Llamadas anidadas desde el llamante y desde los hilos del pool: el interior va en serie
+    {
+        NN::ThreadPool pool(4);
+        std::atomic<size_t> sum{0};
+        pool.parallel_for(64, 1, [&](size_t b, size_t e){
+            for (size_t i = b; i < e; i++)
+                pool.parallel_for(100, 10, [&](size_t b2, size_t e2){
+                    for (size_t j = b2; j < e2; j++)
+                        sum += i*100 + j;
+                });
+        });
+        std::cout << "parallel_for anidado: " << (sum == 20476800 ? "correcto" : "incorrecto") << std::endl;
+        ok = ok && sum == 20476800;
+    }
+
+    // computeParallel con setThreads: cada muestra llama a parallel_for del mismo pool
+    {
+        const size_t si = 1024, so = 512, n = 16;
+        std::vector<float> w(si*so), b(so), in(n*si), out_p(n*so);
+        for (auto &v : w) v = dist(gen);
+        for (auto &v : b) v = dist(gen);
+        for (auto &v : in) v = dist(gen);
+        NN::Net<float> net(si);
+        net.addWGLayer(so, w.data(), b.data());
+        net.addReLuLayer();
+        net.setThreads(4);
+        net.init();
+        net.computeParallel(in.data(), out_p.data(), n);
+        bool eq = true;
+        for (size_t k = 0; k < n; k++)
+        {
+            net.copy2input(in.data()+k*si);
+            net.compute();
+            eq = eq && same(net.getOutput(), out_p.data()+k*so, so);
+        }
+        std::cout << "computeParallel con 4 hilos por capa: " << (eq ? "igual" : "distinta") << std::endl;
+        ok = ok && eq;
+    }
+    return ok ? 0 : 1;
+}
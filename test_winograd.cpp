@@ -0,0 +1,72 @@
+/* Ejemplo: convolución 3x3 por Winograd F(2x2,3x3) y F(4x4,3x3) frente a la directa */
+
+#include "./NNLib/NNLib.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+int main(int argc, char const *argv[])
+{
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    float kernel[9];
+    for (auto &k : kernel) k = dist(gen);
+    float ksum = 0;
+    for (auto k : kernel) ksum += std::fabs(k);
+
+    const NN::ConvMethod methods[] = {NN::ConvMethod::WINOGRAD_2X2, NN::ConvMethod::WINOGRAD_4X4};
+    const char* names[] = {"F(2x2,3x3)", "F(4x4,3x3)"};
+    const NN::dim_t dims[] = {{10, 10}, {37, 23}, {64, 5}, {250, 250}};
+
+    bool ok = true;
+    for (auto dim : dims)
+    {
+        NN::ConvLayer<float> ref(dim), wino(dim);
+        for (size_t i = 0; i < ref.getLayerLen(); i++)
+            ref.getMutInputBlock()[i] = wino.getMutInputBlock()[i] = dist(gen);
+        ref.setMethod(NN::ConvMethod::DIRECT);
+        ref.setKernel({{3,3}, kernel});
+        wino.setKernel({{3,3}, kernel});
+        for (auto padding : {NN::ConvPadding::VALID, NN::ConvPadding::SAME})
+        {
+            ref.setPadding(padding);
+            wino.setPadding(padding);
+            ref.compute();
+            for (size_t m = 0; m < 2; m++)
+            {
+                wino.setMethod(methods[m]);
+                wino.compute();
+                float err = 0;
+                for (size_t i = 0; i < ref.getLayerLen(); i++)
+                    err = std::max(err, std::fabs(ref.getOutputBlock()[i]-wino.getOutputBlock()[i]));
+                // |x| <= 1: el error relativo a sum|k| está acotado por unos pocos épsilon
+                const float bound = (m == 0 ? 8 : 64)*std::numeric_limits<float>::epsilon()*ksum;
+                std::cout << dim.cols << "x" << dim.rows << " " << names[m] << (wino.method() == methods[m] ? "" : " (directa)")
+                          << ": error max " << err << " (cota " << bound << ")" << std::endl;
+                ok = ok && err <= bound;
+            }
+        }
+    }
+
+    // Imagen grande
+    NN::dim_t dim{320, 200};
+    NN::ConvLayer<float> conv(dim);
+    for (size_t i = 0; i < size_t(dim.rows)*dim.cols; i++)
+        conv.getMutInputBlock()[i] = dist(gen);
+    conv.setKernel({{3,3}, kernel});
+    const NN::ConvMethod timed[] = {NN::ConvMethod::DIRECT, NN::ConvMethod::WINOGRAD_2X2, NN::ConvMethod::WINOGRAD_4X4};
+    const char* tnames[] = {"Directa", names[0], names[1]};
+    for (size_t m = 0; m < 3; m++)
+    {
+        conv.setMethod(timed[m]);
+        conv.compute();
+        auto t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < 200; k++)
+            conv.compute();
+        auto t1 = std::chrono::steady_clock::now();
+        std::cout << "320x200 " << tnames[m] << ": " << std::chrono::duration<double, std::milli>(t1-t0).count()/200 << " ms" << std::endl;
+    }
+    return ok ? 0 : 1;
+}